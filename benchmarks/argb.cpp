@@ -37,7 +37,7 @@ TEST_CASE ("Melatonin Blur ARGB Benchmarks")
 
                     BENCHMARK ("Melatonin uncached")
                     {
-                        // uses a temp copy internally
+                        // reads src, writes dst
                         melatonin::blur::argb (src, dst, radius);
                         g.drawImageAt (src, 0, 0, true);
                         auto color = dstData.getPixelColour (20, 20);
@@ -53,6 +53,35 @@ TEST_CASE ("Melatonin Blur ARGB Benchmarks")
                         return color;
                     };
 
+#if MELATONIN_BLUR_SIMD
+                    BENCHMARK ("SIMD integer (" + juce::String (melatonin::blur::activeInstructionSetName()).toStdString() + ")")
+                    {
+                        melatonin::blur::simdARGB (dst, radius);
+                        g.drawImageAt (dst, 0, 0, true);
+                        auto color = dstData.getPixelColour (20, 20);
+                        return color;
+                    };
+#endif
+
+                    // only worth it from radius 16 up, where it starts halving
+                    BENCHMARK ("Dual filter")
+                    {
+                        melatonin::blur::dualFilterARGB (dst, radius);
+                        g.drawImageAt (dst, 0, 0, true);
+                        auto color = dstData.getPixelColour (20, 20);
+                        return color;
+                    };
+
+                    melatonin::blur::enableMultithreading();
+                    BENCHMARK ("Melatonin uncached (multithreaded)")
+                    {
+                        melatonin::blur::argb (src, dst, radius);
+                        g.drawImageAt (src, 0, 0, true);
+                        auto color = dstData.getPixelColour (20, 20);
+                        return color;
+                    };
+                    melatonin::blur::disableMultithreading();
+
                     BENCHMARK ("Melatonin Cached")
                     {
                         // returns a juce::Image to render
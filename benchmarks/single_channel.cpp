@@ -77,6 +77,22 @@ TEST_CASE ("Melatonin Blur Single Channel Benchmarks")
                         return color;
                     };
 
+#if MELATONIN_BLUR_SIMD
+                    BENCHMARK ("SIMD float (" + juce::String (melatonin::blur::activeInstructionSetName()).toStdString() + ")")
+                    {
+                        melatonin::blur::simdFloatSingleChannel (image, radius);
+                        auto color = data.getPixelColour (dimension - radius, dimension - radius);
+                        return color;
+                    };
+
+                    BENCHMARK ("SIMD integer (" + juce::String (melatonin::blur::activeInstructionSetName()).toStdString() + ")")
+                    {
+                        melatonin::blur::simdSingleChannel (image, radius);
+                        auto color = data.getPixelColour (dimension - radius, dimension - radius);
+                        return color;
+                    };
+#endif
+
                     BENCHMARK ("Melatonin")
                     {
                         melatonin::blur::singleChannel (image, radius);
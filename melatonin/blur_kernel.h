@@ -0,0 +1,11 @@
+#pragma once
+
+namespace melatonin::blur
+{
+    enum class Kernel {
+        stack, // stack blur's triangle, what every shadow uses
+        gaussian, // 3 extended box passes, sigma = radius / 2 (matches Figma and CSS)
+        recursiveGaussian, // IIR filter, same sigma, the cost and memory don't grow with radius
+        dualFilter, // stack blur on a downsampled pyramid, much faster for radius 64+ but loses fine detail
+    };
+}
@@ -1,4 +1,6 @@
 #include "cached_blur.h"
+#include "internal/image_hash.h"
+#include "internal/image_regions.h"
 #include "internal/implementations.h"
 #include "internal/rendered_single_channel_shadow.h"
 
@@ -15,31 +17,210 @@ namespace melatonin
         jassert (newSource.isValid());
         src = newSource;
 
-        // the first time the blur is created, a copy is needed
-        // so we are passing correct dimensions, etc to the blur algo
-        dst = src.createCopy();
-        blur::argb (src, dst, radius);
+        // the blur reads src and writes into dst, so dst is only (re)allocated when the size changes
+        // that way live updates don't allocate or copy a whole image every time
+        if (! dst.isValid() || dst.getBounds() != src.getBounds() || dst.getFormat() != src.getFormat())
+            dst = juce::Image (src.getFormat(), src.getWidth(), src.getHeight(), false, *src.getPixelData()->createType());
+
+        sourceRegion = {};
+        blurInto (src, dst);
+
+        // hashed after blurring, in case src is dst (blurring our own output in place)
+        if (detectContentChanges)
+            sourceHash = blur::hashImage (src);
+
+        if (detectChangedAreas)
+        {
+            if (previousSource.getBounds() != src.getBounds() || previousSource.getFormat() != src.getFormat())
+                previousSource = juce::Image (src.getFormat(), src.getWidth(), src.getHeight(), false, *src.getPixelData()->createType());
+            blur::copyPixels (src, src.getBounds(), previousSource, {});
+        }
+
+        needsRedraw = false;
+    }
+
+    void CachedBlur::update (const juce::Image& newSource, juce::Rectangle<int> dirtyArea)
+    {
+        jassert (newSource.isValid());
+
+        // Stack blur is exact integer math, so blurring a crop gives the same pixels as blurring everything
+        // The other kernels would be off by a rounding error at the seams
+        const auto canUpdatePart = ! needsRedraw
+                                   && kernel == blur::Kernel::stack
+                                   && sourceRegion.isEmpty()
+                                   && dst.isValid()
+                                   && newSource != dst
+                                   && newSource.getBounds() == dst.getBounds()
+                                   && newSource.getFormat() == dst.getFormat();
+
+        // every output pixel within radius of a changed pixel changes (ARGB stack blurs use a radius of at least 2)
+        const auto halo = (int) juce::jmax (radius, (size_t) 2);
+        const auto changed = dirtyArea.expanded (halo).getIntersection (newSource.getBounds());
+
+        // ...and reads the source pixels within radius of itself
+        const auto readArea = changed.expanded (halo).getIntersection (newSource.getBounds());
+
+        if (! canUpdatePart || readArea == newSource.getBounds())
+        {
+            update (newSource);
+            return;
+        }
+
+        src = newSource;
+
+        if (! changed.isEmpty())
+        {
+            if (partialBlur.getWidth() < readArea.getWidth() || partialBlur.getHeight() < readArea.getHeight() || partialBlur.getFormat() != src.getFormat())
+            {
+                const auto width = juce::jmax (partialBlur.getWidth(), readArea.getWidth());
+                const auto height = juce::jmax (partialBlur.getHeight(), readArea.getHeight());
+                partialBlur = juce::Image (src.getFormat(), width, height, false, *src.getPixelData()->createType());
+            }
+
+            // blur everything the changed area reads, then keep only the changed area
+            // (the rest is too close to the edge of the crop to be right)
+            auto blurred = partialBlur.getClippedImage (readArea.withZeroOrigin());
+            blur::argb (src.getClippedImage (readArea), blurred, radius);
+            blur::copyPixels (blurred, changed - readArea.getPosition(), dst, changed.getPosition());
+        }
+
+        if (detectContentChanges)
+            sourceHash = blur::hashImage (src);
+
+        if (detectChangedAreas)
+        {
+            const auto copied = dirtyArea.getIntersection (src.getBounds());
+            blur::copyPixels (src, copied, previousSource, copied.getPosition());
+        }
+    }
+
+    void CachedBlur::updateRegion (const juce::Image& newSource, juce::Rectangle<int> region)
+    {
+        jassert (newSource.isValid());
+        jassert (newSource.getBounds().contains (region) && ! region.isEmpty());
+        src = newSource;
+        sourceRegion = region;
+
+        if (! dst.isValid() || dst.getBounds() != region.withZeroOrigin() || dst.getFormat() != src.getFormat())
+            dst = juce::Image (src.getFormat(), region.getWidth(), region.getHeight(), false, *src.getPixelData()->createType());
+
+        const auto readArea = regionReadArea();
+        if (readArea == region)
+            blurInto (src.getClippedImage (region), dst);
+        else
+        {
+            // like a partial update: blur everything the region reads, then keep only the region
+            if (partialBlur.getWidth() < readArea.getWidth() || partialBlur.getHeight() < readArea.getHeight() || partialBlur.getFormat() != src.getFormat())
+            {
+                const auto width = juce::jmax (partialBlur.getWidth(), readArea.getWidth());
+                const auto height = juce::jmax (partialBlur.getHeight(), readArea.getHeight());
+                partialBlur = juce::Image (src.getFormat(), width, height, false, *src.getPixelData()->createType());
+            }
+
+            auto blurred = partialBlur.getClippedImage (readArea.withZeroOrigin());
+            blurInto (src.getClippedImage (readArea), blurred);
+            blur::copyPixels (blurred, region - readArea.getPosition(), dst, {});
+        }
+
+        if (detectContentChanges)
+            sourceHash = blur::hashImage (src.getClippedImage (readArea));
+
+        needsRedraw = false;
+    }
+
+    juce::Image& CachedBlur::renderRegion (const juce::Image& newSource, juce::Rectangle<int> region)
+    {
+        if (needsRedraw || newSource != src || region != sourceRegion)
+            updateRegion (newSource, region);
+        else if (detectContentChanges && blur::hashImage (newSource.getClippedImage (regionReadArea())) != sourceHash)
+            updateRegion (newSource, region);
+
+        return dst;
     }
 
     juce::Image& CachedBlur::render (const juce::Image& newSource)
     {
-        // TODO: This doesn't check if image contents have changed
-        // Only that a new image is being passed in.
-        // This is problematic for juce::ImageEffectFilter::applyEffect
-        // because the image passed in will always be the same image.
-        // In that case, you can directly call update
-        if (needsRedraw || newSource != src)
+        // Comparing images only checks that the same image is being passed in, not its contents
+        // juce::ImageEffectFilter::applyEffect for example always passes the same image
+        // so the pixels have to be compared too (or the caller has to tell us with markDirty or a revision)
+        if (needsRedraw || newSource != src || ! sourceRegion.isEmpty())
+            update (newSource);
+        else if (detectChangedAreas)
+        {
+            const auto changed = blur::findChangedArea (previousSource, newSource);
+            if (! changed.isEmpty())
+                update (newSource, changed);
+        }
+        else if (detectContentChanges && blur::hashImage (newSource) != sourceHash)
             update (newSource);
 
         return dst;
     }
 
+    juce::Image& CachedBlur::render (const juce::Image& newSource, uint64_t sourceRevision)
+    {
+        if (sourceRevision != lastRevision)
+        {
+            lastRevision = sourceRevision;
+            needsRedraw = true;
+        }
+
+        return render (newSource);
+    }
+
     void CachedBlur::setRadius (size_t newRadius)
     {
         radius = newRadius;
         needsRedraw = true;
     }
 
+    void CachedBlur::setKernel (blur::Kernel newKernel)
+    {
+        kernel = newKernel;
+        needsRedraw = true;
+    }
+
+    void CachedBlur::setDualFilterLevels (size_t numLevels)
+    {
+        dualFilterLevels = numLevels;
+        needsRedraw = true;
+    }
+
+    void CachedBlur::setDetectContentChanges (bool shouldDetect)
+    {
+        // the hash wasn't kept up to date while this was off, so start fresh
+        if (shouldDetect && ! detectContentChanges)
+            needsRedraw = true;
+
+        detectContentChanges = shouldDetect;
+    }
+
+    void CachedBlur::setDetectChangedAreas (bool shouldDetect)
+    {
+        // there's no copy to compare against yet
+        if (shouldDetect && ! detectChangedAreas)
+            needsRedraw = true;
+
+        if (! shouldDetect)
+            previousSource = {};
+
+        detectChangedAreas = shouldDetect;
+    }
+
+    void CachedBlur::blurInto (const juce::Image& from, juce::Image& to)
+    {
+        if (kernel == blur::Kernel::dualFilter)
+            blur::dualFilterARGB (from, to, radius, dualFilterLevels);
+        else
+            blur::argb (from, to, radius, kernel);
+    }
+
+    // The region and the pixels around it that its blur reads
+    juce::Rectangle<int> CachedBlur::regionReadArea() const
+    {
+        return sourceRegion.expanded ((int) blur::blurHalo (kernel, radius)).getIntersection (src.getBounds());
+    }
+
     juce::Image& CachedBlur::render()
     {
         // You either need to have called update or rendered with a src!
@@ -1,4 +1,5 @@
 #pragma once
+#include "blur_kernel.h"
 
 namespace melatonin
 {
@@ -11,23 +12,84 @@ namespace melatonin
         // (but it's a value object of sorts since its reference counted)
         void update (const juce::Image& newSource);
 
+        // Only reblurs what dirtyArea (the part of newSource that changed) can reach: dirtyArea expanded by the radius
+        // For a small change in a big, mostly static backdrop (a meter, a cursor) that's a fraction of a full update
+        // Falls back to a full update for kernels other than stack blur and when the size changed
+        void update (const juce::Image& newSource, juce::Rectangle<int> dirtyArea);
+
+        // Blurs just region of newSource, without copying it out first. The result is region's size
+        // The pixels around region are read from newSource as far as the blur reaches, so the edges
+        // line up with the rest of the image: a glass panel over a window's snapshot has no seams
+        void updateRegion (const juce::Image& newSource, juce::Rectangle<int> region);
+
+        // Same as render, for a region (only reblurs when the image or the region is different)
+        // Content detection only hashes the part of newSource the region reads, changed area detection doesn't apply
+        juce::Image& renderRegion (const juce::Image& newSource, juce::Rectangle<int> region);
+
         // Render and potentially update the image
+        // By default this only reblurs when it's handed a different image (or a setter was called)
+        // See setDetectContentChanges for images that are drawn into and passed again
         juce::Image& render (const juce::Image& newSource);
 
+        // Same, but also reblurs whenever sourceRevision differs from the last one passed in
+        // Bump your own counter every time you draw into the source, and the cache can't go stale
+        juce::Image& render (const juce::Image& newSource, uint64_t sourceRevision);
+
         // Render the image from cache
         juce::Image& render();
 
         void setRadius (size_t newRadius);
         void setRadius (const float newRadius) { setRadius ((size_t) juce::roundToInt (newRadius)); }
 
+        // Stack blur by default, see blur::Kernel for the Gaussian and faster options
+        void setKernel (blur::Kernel newKernel);
+
+        // Only for blur::Kernel::dualFilter: how many times the image is halved before blurring
+        // More is faster and loses more detail. 0 (the default) picks from the radius
+        void setDualFilterLevels (size_t numLevels);
+
+        // The next render reblurs, even when it's passed the same image
+        // For when you know the source's pixels changed
+        void markDirty() { needsRedraw = true; }
+
+        // Passing the same juce::Image again (like juce::ImageEffectFilter::applyEffect does)
+        // normally gets the cached blur, even if its pixels have since changed.
+        // With this on, render hashes the pixels too and reblurs exactly when they changed.
+        // That costs a read over the image on every render, still far cheaper than blurring it
+        void setDetectContentChanges (bool shouldDetect);
+
+        // Goes a step further: keeps a copy of the source and compares against it on every render,
+        // then only reblurs the area that changed (see update with a dirtyArea)
+        // That costs an image's worth of memory and a compare per render
+        void setDetectChangedAreas (bool shouldDetect);
+
         [[nodiscard]] bool isValid() const { return dst.isValid(); }
     private:
         // juce::Images are value objects, reference counted behind the scenes
         // We want to store a reference to the src so we can compare on render
         // And we actually are the owner of the dst
         size_t radius = 0;
+        blur::Kernel kernel = blur::Kernel::stack;
+        size_t dualFilterLevels = 0;
         juce::Image src {};
         juce::Image dst {};
+        juce::Rectangle<int> sourceRegion {}; // empty when all of src was blurred
         bool needsRedraw = false;
+
+        // only kept up to date when detectContentChanges is on
+        bool detectContentChanges = false;
+        uint64_t sourceHash = 0;
+
+        // only kept when detectChangedAreas is on
+        bool detectChangedAreas = false;
+        juce::Image previousSource {};
+
+        // partial updates blur into this first, it only grows
+        juce::Image partialBlur {};
+
+        uint64_t lastRevision = 0;
+
+        void blurInto (const juce::Image& from, juce::Image& to);
+        [[nodiscard]] juce::Rectangle<int> regionReadArea() const;
     };
 }
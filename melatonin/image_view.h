@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace melatonin::blur
+{
+    /*
+     * Pixels for the blur to read or write, wherever they live:
+     * a juce::Image's BitmapData, a buffer you own, an mmap'd file...
+     *
+     * pixelStride is 1 for single channel and 4 for ARGB (premultiplied, in juce::PixelARGB's byte order).
+     * lineStride is the number of bytes from one row to the next, padding included.
+     *
+     * A view doesn't own anything, and blurring through one never allocates or copies the image.
+     */
+    struct ImageView
+    {
+        uint8_t* data = nullptr;
+        size_t width = 0;
+        size_t height = 0;
+        size_t lineStride = 0;
+        size_t pixelStride = 0;
+
+        [[nodiscard]] uint8_t* getLinePointer (size_t y) const { return data + y * lineStride; }
+        [[nodiscard]] uint8_t* getPixelPointer (size_t x, size_t y) const { return getLinePointer (y) + x * pixelStride; }
+
+        // A rectangle of the same pixels
+        [[nodiscard]] ImageView getSubView (size_t x, size_t y, size_t w, size_t h) const
+        {
+            return { getPixelPointer (x, y), w, h, lineStride, pixelStride };
+        }
+
+        [[nodiscard]] bool isEmpty() const { return width == 0 || height == 0; }
+
+        // Views of the same pixels, so a blur from one to the other happens in place
+        [[nodiscard]] bool operator== (const ImageView& other) const
+        {
+            return data == other.data && width == other.width && height == other.height && lineStride == other.lineStride && pixelStride == other.pixelStride;
+        }
+
+        [[nodiscard]] bool operator!= (const ImageView& other) const { return ! (*this == other); }
+    };
+}
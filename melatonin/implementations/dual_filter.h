@@ -0,0 +1,198 @@
+#pragma once
+#include "../image_view.h"
+#include "../internal/scratch.h"
+#include "juce_graphics/juce_graphics.h"
+#include <array>
+
+/*
+ * Dual filter (Kawase) pyramid blur, for very big, very soft blurs.
+ * See Marius Bjørge, "Bandwidth-Efficient Rendering" (SIGGRAPH 2015)
+ *
+ * The image is halved a few times with a small low pass filter,
+ * blurred at the bottom of the pyramid (with a radius just as many times smaller)
+ * and then doubled back up with a bilinear tent filter.
+ *
+ * Every level has a quarter of the pixels of the one above, so nearly all the work
+ * happens on tiny images. The cost is a couple of cheap passes over the full size image.
+ * The catch is detail: anything finer than the bottom level is gone,
+ * which nobody can see behind a radius 64+ frosted glass anyway.
+ */
+namespace melatonin::blur
+{
+    // Below this, the bottom of the pyramid gets blocky
+    static constexpr size_t minDualFilterBottomRadius = 8;
+
+    // Halve until the radius at the bottom gets small
+    [[nodiscard]] static inline size_t dualFilterLevelsFor (size_t radius)
+    {
+        size_t levels = 0;
+        while ((radius >> (levels + 1)) >= minDualFilterBottomRadius)
+            ++levels;
+        return levels;
+    }
+
+    // The pyramid blurs a little by itself: every down + up adds a variance of 1.5 pixels^2 at its scale.
+    // The bottom blur makes up the rest of the stack blur's variance, radius * (radius + 2) / 6
+    [[nodiscard]] static inline size_t dualFilterBottomRadius (size_t radius, size_t numLevels)
+    {
+        const auto scale = std::pow (4.0, (double) numLevels);
+        const auto targetVariance = (double) radius * (double) (radius + 2) / 6.0;
+        const auto pyramidVariance = 0.5 * (scale - 1.0);
+        const auto bottomVariance = juce::jmax (0.0, targetVariance - pyramidVariance) / scale;
+
+        // invert variance = r * (r + 2) / 6
+        return (size_t) juce::roundToInt (std::sqrt (1.0 + 6.0 * bottomVariance) - 1.0);
+    }
+
+    // Halves the image with Bjørge's downsample filter: the 2x2 block under the new pixel,
+    // plus the 4 diagonal 2x2 blocks around it, at half weight together. That's this 4x4 kernel / 32:
+    //
+    //  1 1 1 1
+    //  1 5 5 1
+    //  1 5 5 1
+    //  1 1 1 1
+    template <typename Pixel>
+    static void dualFilterDownsample (const ImageView& src, const ImageView& dst)
+    {
+        constexpr auto numChannels = sizeof (Pixel);
+        const auto srcWidth = src.width;
+        const auto dstWidth = dst.width;
+        const auto srcHeight = (int) src.height;
+
+        // the source row gets one repeated edge pixel on either side, so the loops below never clamp
+        const auto paddedBytes = (srcWidth + 3) * numChannels;
+        ScratchFrame scratch;
+        auto outer = scratch.allocate<uint16_t> (paddedBytes);
+        auto inner = scratch.allocate<uint16_t> (paddedBytes);
+
+        for (int y = 0; y < (int) dst.height; ++y)
+        {
+            auto row = [&] (int index) { return src.getLinePointer ((size_t) juce::jlimit (0, srcHeight - 1, index)); };
+            auto r0 = row (2 * y - 1), r1 = row (2 * y), r2 = row (2 * y + 1), r3 = row (2 * y + 2);
+
+            // vertical weights 1 1 1 1 and 1 5 5 1
+            for (size_t i = 0; i < srcWidth * numChannels; ++i)
+            {
+                outer[numChannels + i] = (uint16_t) (r0[i] + r1[i] + r2[i] + r3[i]);
+                inner[numChannels + i] = (uint16_t) (r0[i] + 5 * (r1[i] + r2[i]) + r3[i]);
+            }
+
+            for (size_t c = 0; c < numChannels; ++c)
+            {
+                outer[c] = outer[numChannels + c];
+                inner[c] = inner[numChannels + c];
+                for (auto edge = srcWidth + 1; edge < srcWidth + 3; ++edge)
+                {
+                    outer[edge * numChannels + c] = outer[srcWidth * numChannels + c];
+                    inner[edge * numChannels + c] = inner[srcWidth * numChannels + c];
+                }
+            }
+
+            // horizontal weights outer, inner, inner, outer
+            // (padded pixel 2x is the source pixel left of the new pixel's 2x2 block)
+            auto out = dst.getLinePointer ((size_t) y);
+            for (size_t x = 0; x < dstWidth; ++x)
+            {
+                auto o = outer + 2 * x * numChannels;
+                auto in = inner + 2 * x * numChannels;
+                for (size_t c = 0; c < numChannels; ++c)
+                    out[x * numChannels + c] = (uint8_t) ((o[c] + in[numChannels + c] + in[2 * numChannels + c] + o[3 * numChannels + c] + 16) >> 5);
+            }
+        }
+    }
+
+    // Doubles the image back up (cropped to dst's size) with bilinear weights:
+    // every new pixel sits a quarter of the way between 2 old ones in each direction, so 1/4 and 3/4
+    template <typename Pixel>
+    static void dualFilterUpsample (const ImageView& src, const ImageView& dst)
+    {
+        constexpr auto numChannels = sizeof (Pixel);
+        const auto srcWidth = src.width;
+        const auto srcHeight = (int) src.height;
+        const auto rowBytes = srcWidth * numChannels;
+
+        // the vertical blend, padded with a repeated edge pixel on either side
+        ScratchFrame scratch;
+        auto blended = scratch.allocate<uint16_t> (rowBytes + 2 * numChannels);
+
+        // the even and odd output pixels, each a whole source row wide
+        auto even = scratch.allocate<Pixel> (srcWidth);
+        auto odd = scratch.allocate<Pixel> (srcWidth);
+        auto evenBytes = reinterpret_cast<uint8_t*> (even);
+        auto oddBytes = reinterpret_cast<uint8_t*> (odd);
+
+        for (int y = 0; y < (int) dst.height; ++y)
+        {
+            // even rows lean on the source row above, odd rows on the one below
+            const auto nearest = y / 2;
+            auto nearestRow = src.getLinePointer ((size_t) juce::jmin (nearest, srcHeight - 1));
+            auto otherRow = src.getLinePointer ((size_t) juce::jlimit (0, srcHeight - 1, (y % 2 == 0) ? nearest - 1 : nearest + 1));
+
+            auto middle = blended + numChannels;
+            for (size_t i = 0; i < rowBytes; ++i)
+                middle[i] = (uint16_t) (3 * nearestRow[i] + otherRow[i]);
+
+            for (size_t c = 0; c < numChannels; ++c)
+            {
+                blended[c] = middle[c];
+                middle[rowBytes + c] = middle[rowBytes - numChannels + c];
+            }
+
+            // same again horizontally, lane by lane
+            auto left = middle - numChannels;
+            auto right = middle + numChannels;
+            for (size_t i = 0; i < rowBytes; ++i)
+            {
+                evenBytes[i] = (uint8_t) ((3 * middle[i] + left[i] + 8) >> 4);
+                oddBytes[i] = (uint8_t) ((3 * middle[i] + right[i] + 8) >> 4);
+            }
+
+            // interleave whole pixels, the last odd one is cropped off odd widths
+            auto out = reinterpret_cast<Pixel*> (dst.getLinePointer ((size_t) y));
+            for (size_t x = 0; x < dst.width; ++x)
+                out[x] = (x % 2 == 0) ? even[x / 2] : odd[x / 2];
+        }
+    }
+
+    // numLevels of 0 picks from the radius, more levels is faster and loses more detail
+    // bottomBlur is the regular blur for this format, run in place on the smallest level
+    // src and dst can be the same view: the first level down is read from src and the last level up is written to dst
+    template <typename Pixel, typename Blur>
+    static void dualFilter (const ImageView& src, const ImageView& dst, size_t radius, size_t numLevels, Blur&& bottomBlur)
+    {
+        jassert (src.width == dst.width && src.height == dst.height && src.pixelStride == dst.pixelStride);
+
+        if (numLevels == 0)
+            numLevels = dualFilterLevelsFor (radius);
+
+        // the pyramid, largest first (dst is level 0), the smaller levels live in scratch memory
+        // halving a size_t can't happen more than 64 times before it gets to 1
+        ScratchFrame scratch;
+        std::array<ImageView, 65> levels;
+        levels[0] = dst;
+        size_t bottom = 0;
+        while (bottom < numLevels && (levels[bottom].width > 1 || levels[bottom].height > 1))
+        {
+            const auto& above = bottom == 0 ? src : levels[bottom];
+            const auto width = (above.width + 1) / 2;
+            const auto height = (above.height + 1) / 2;
+            levels[++bottom] = { scratch.allocate<uint8_t> (width * height * sizeof (Pixel)), width, height, width * sizeof (Pixel), sizeof (Pixel) };
+
+            dualFilterDownsample<Pixel> (above, levels[bottom]);
+        }
+
+        // no pyramid at all (a 1x1 image), the bottom blur has to work on dst directly
+        if (bottom == 0 && src != dst)
+        {
+            for (size_t y = 0; y < src.height; ++y)
+                memcpy (dst.getLinePointer (y), src.getLinePointer (y), src.width * src.pixelStride);
+        }
+
+        const auto bottomRadius = dualFilterBottomRadius (radius, bottom);
+        if (bottomRadius > 0)
+            bottomBlur (levels[bottom], bottomRadius);
+
+        for (auto level = bottom; level > 0; --level)
+            dualFilterUpsample<Pixel> (levels[level], levels[level - 1]);
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include "../internal/cache_strips.h"
+#include "../internal/scratch.h"
+#include "../internal/source_and_destination.h"
+#include "../internal/transpose.h"
+#include "juce_graphics/juce_graphics.h"
+
+/*
+ * Gaussian blur approximated by 3 box blurs in a row.
+ *
+ * Stack blur's triangle is only a rough Gaussian. Design tools (Figma, CSS) use a real one,
+ * with sigma = blur radius / 2. Three boxes get much closer to that and are cheaper per pixel.
+ *
+ * Plain boxes only come in odd integer widths, so most sigmas can't be hit exactly.
+ * "Extended" boxes add a fractional tap on either end, so any sigma can be.
+ * See Gwosdek et al, "Theoretical Foundations of Gaussian Convolution by Extended Box Filtering"
+ *
+ * Every box is a running sum: O(1) per pixel, whatever the radius.
+ * Like the other vector implementations, a pass runs down whole rows at once (so the loops vectorize)
+ * and the horizontal pass transposes the image first.
+ */
+namespace melatonin::blur
+{
+    // 2 * radius + 1 taps of weight 1, plus one tap of weight `fraction` on either end
+    struct ExtendedBox
+    {
+        size_t radius;
+        float fraction;
+        float scale; // normalizes the weights to 1
+    };
+
+    // The box that, applied numPasses times, has the variance of a Gaussian with this sigma
+    [[nodiscard]] static inline ExtendedBox extendedBoxFor (float sigma, size_t numPasses)
+    {
+        const auto variance = sigma * sigma / (float) numPasses;
+
+        // the widest plain box that doesn't overshoot the variance
+        const auto radius = (size_t) std::floor (0.5f * std::sqrt (12.0f * variance + 1.0f) - 0.5f);
+        const auto r = (float) radius;
+
+        // the outer taps make up the rest
+        const auto fraction = (2.0f * r + 1.0f) * (variance - r * (r + 1.0f) / 3.0f) / (2.0f * ((r + 1.0f) * (r + 1.0f) - variance));
+        return { radius, fraction, 1.0f / (2.0f * r + 1.0f + 2.0f * fraction) };
+    }
+
+    // sigma is radius / 2, like CSS and Figma
+    [[nodiscard]] static inline ExtendedBox extendedBoxForRadius (size_t radius)
+    {
+        return extendedBoxFor ((float) juce::jmax ((size_t) 1, radius) / 2.0f, 3);
+    }
+
+    // How many pixels away a pixel can still change the blur: each of the 3 boxes reaches radius + 1
+    [[nodiscard]] static inline size_t extendedBoxGaussianReach (size_t radius)
+    {
+        return 3 * (extendedBoxForRadius (radius).radius + 1);
+    }
+
+    // One box over `length` lines of `numLanes` independent values, progressing downwards
+    // src and dst must be different, the running sum needs the untouched input
+    template <typename In, typename Out>
+    static void extendedBoxPass (const In* src, size_t srcLineStride, Out* dst, size_t dstLineStride, size_t numLanes, size_t length, ExtendedBox box, float* sum)
+    {
+        const auto lastLine = (std::ptrdiff_t) length - 1;
+        auto line = [&] (std::ptrdiff_t index) { return src + (size_t) juce::jlimit ((std::ptrdiff_t) 0, lastLine, index) * srcLineStride; };
+        const auto r = (std::ptrdiff_t) box.radius;
+
+        // the box around line 0, with the top pixel repeated above the image
+        std::fill_n (sum, numLanes, 0.0f);
+        for (auto k = -r; k <= r; ++k)
+        {
+            auto values = line (k);
+            for (size_t i = 0; i < numLanes; ++i)
+                sum[i] += (float) values[i];
+        }
+
+        for (std::ptrdiff_t x = 0; x <= lastLine; ++x)
+        {
+            auto out = dst + (size_t) x * dstLineStride;
+            auto above = line (x - r - 1);
+            auto below = line (x + r + 1);
+            auto outgoing = line (x - r);
+
+            for (size_t i = 0; i < numLanes; ++i)
+            {
+                auto blurred = (sum[i] + box.fraction * ((float) above[i] + (float) below[i])) * box.scale;
+                if constexpr (std::is_same_v<Out, uint8_t>)
+                    out[i] = (uint8_t) (blurred + 0.5f);
+                else
+                    out[i] = blurred;
+            }
+
+            // slide the box down a line
+            for (size_t i = 0; i < numLanes; ++i)
+                sum[i] += (float) below[i] - (float) outgoing[i];
+        }
+    }
+
+    // All 3 boxes down one strip of columns, ping-ponging through float buffers in between
+    // Keeping floats in between means only the final pass rounds
+    static inline void extendedBoxPasses (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, ExtendedBox box)
+    {
+        ScratchFrame scratch;
+        auto first = scratch.allocate<float> (numLanes * length);
+        auto second = scratch.allocate<float> (numLanes * length);
+        auto sum = scratch.allocate<float> (numLanes);
+
+        extendedBoxPass (data, lineStride, first, numLanes, numLanes, length, box, sum);
+        extendedBoxPass (first, numLanes, second, numLanes, numLanes, length, box, sum);
+        extendedBoxPass (second, numLanes, data, lineStride, numLanes, length, box, sum);
+    }
+
+    static inline void extendedBoxStripedPasses (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, ExtendedBox box, size_t numTasks)
+    {
+        // per column: the two float buffers
+        forEachStrip (numLanes, 2 * length * sizeof (float), numTasks, [&] (size_t x, size_t columns) {
+            extendedBoxPasses (data + x, lineStride, columns, length, box);
+        });
+    }
+
+    // Every byte is its own lane, so single channel and ARGB only differ in how they transpose
+    // Reads from src and writes to dst (which can be the same view)
+    template <typename Pixel>
+    static void extendedBoxGaussian (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        SourceAndDestination images (src, dst);
+        const auto w = images.width();
+        const auto h = images.height();
+        jassert (images.pixelStride() == sizeof (Pixel));
+
+        const auto box = extendedBoxForRadius (radius);
+        const auto numTasks = parallelTasksFor (w * h);
+
+        // HORIZONTAL PASSES: rows become columns, so the passes can do them all at once
+        const auto columnBytes = h * sizeof (Pixel);
+        ScratchFrame scratch;
+        auto transposed = scratch.allocate<uint8_t> (columnBytes * w);
+        transpose<Pixel> (images.source(), images.sourceLineStride(), transposed, columnBytes, w, h, numTasks);
+        extendedBoxStripedPasses (transposed, columnBytes, columnBytes, w, box, numTasks);
+        transpose<Pixel> (transposed, columnBytes, images.destination(), images.destinationLineStride(), h, w, numTasks);
+
+        // VERTICAL PASSES
+        extendedBoxStripedPasses (images.destination(), images.destinationLineStride(), w * sizeof (Pixel), h, box, numTasks);
+    }
+
+    [[maybe_unused]] static void extendedBoxSingleChannel (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        extendedBoxGaussian<uint8_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void extendedBoxSingleChannel (juce::Image& img, size_t radius)
+    {
+        MappedImages images (img, img);
+        extendedBoxGaussian<uint8_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void extendedBoxARGB (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        extendedBoxGaussian<uint32_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void extendedBoxARGB (const juce::Image& src, juce::Image& dst, size_t radius)
+    {
+        MappedImages images (src, dst);
+        extendedBoxGaussian<uint32_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void extendedBoxARGB (juce::Image& img, size_t radius)
+    {
+        extendedBoxARGB (img, img, radius);
+    }
+}
@@ -37,6 +37,7 @@ Excerpted for testing, benchmarking, and use of rgba algo on windows
 
 #pragma once
 
+#include "../internal/source_and_destination.h"
 #include "juce_graphics/juce_graphics.h"
 
 namespace melatonin::stackBlur
@@ -44,12 +45,10 @@ namespace melatonin::stackBlur
     const unsigned short stackblur_mul[255] = { 512, 512, 456, 512, 328, 456, 335, 512, 405, 328, 271, 456, 388, 335, 292, 512, 454, 405, 364, 328, 298, 271, 496, 456, 420, 388, 360, 335, 312, 292, 273, 512, 482, 454, 428, 405, 383, 364, 345, 328, 312, 298, 284, 271, 259, 496, 475, 456, 437, 420, 404, 388, 374, 360, 347, 335, 323, 312, 302, 292, 282, 273, 265, 512, 497, 482, 468, 454, 441, 428, 417, 405, 394, 383, 373, 364, 354, 345, 337, 328, 320, 312, 305, 298, 291, 284, 278, 271, 265, 259, 507, 496, 485, 475, 465, 456, 446, 437, 428, 420, 412, 404, 396, 388, 381, 374, 367, 360, 354, 347, 341, 335, 329, 323, 318, 312, 307, 302, 297, 292, 287, 282, 278, 273, 269, 265, 261, 512, 505, 497, 489, 482, 475, 468, 461, 454, 447, 441, 435, 428, 422, 417, 411, 405, 399, 394, 389, 383, 378, 373, 368, 364, 359, 354, 350, 345, 341, 337, 332, 328, 324, 320, 316, 312, 309, 305, 301, 298, 294, 291, 287, 284, 281, 278, 274, 271, 268, 265, 262, 259, 257, 507, 501, 496, 491, 485, 480, 475, 470, 465, 460, 456, 451, 446, 442, 437, 433, 428, 424, 420, 416, 412, 408, 404, 400, 396, 392, 388, 385, 381, 377, 374, 370, 367, 363, 360, 357, 354, 350, 347, 344, 341, 338, 335, 332, 329, 326, 323, 320, 318, 315, 312, 310, 307, 304, 302, 299, 297, 294, 292, 289, 287, 285, 282, 280, 278, 275, 273, 271, 269, 267, 265, 263, 261, 259 };
     const unsigned char stackblur_shr[255] = { 9, 11, 12, 13, 13, 14, 14, 15, 15, 15, 15, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24 };
 
-    static void ginSingleChannel (juce::Image& img, unsigned int radius)
+    static void ginSingleChannel (const melatonin::blur::ImageView& data, unsigned int radius)
     {
-        const unsigned int w = (unsigned int) img.getWidth();
-        const unsigned int h = (unsigned int) img.getHeight();
-
-        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        const unsigned int w = (unsigned int) data.width;
+        const unsigned int h = (unsigned int) data.height;
 
         radius = juce::jlimit (1u, 254u, radius);
 
@@ -74,7 +73,7 @@ namespace melatonin::stackBlur
         {
             sum = sum_in = sum_out = 0;
 
-            src_ptr = data.getLinePointer (int (y));
+            src_ptr = data.getLinePointer (y);
 
             for (i = 0; i <= radius; ++i)
             {
@@ -100,8 +99,8 @@ namespace melatonin::stackBlur
             if (xp > wm)
                 xp = wm;
 
-            src_ptr = data.getLinePointer (int (y)) + (unsigned int) data.pixelStride * xp;
-            dst_ptr = data.getLinePointer (int (y));
+            src_ptr = data.getLinePointer (y) + (unsigned int) data.pixelStride * xp;
+            dst_ptr = data.getLinePointer (y);
 
             for (x = 0; x < w; ++x)
             {
@@ -171,7 +170,7 @@ namespace melatonin::stackBlur
             if (yp > hm)
                 yp = hm;
 
-            src_ptr = data.getLinePointer (int (yp)) + (unsigned int) data.pixelStride * x;
+            src_ptr = data.getLinePointer (yp) + (unsigned int) data.pixelStride * x;
             dst_ptr = data.getLinePointer (0) + (unsigned int) data.pixelStride * x;
 
             for (y = 0; y < h; ++y)
@@ -212,18 +211,15 @@ namespace melatonin::stackBlur
         }
     }
 
-    [[maybe_unused]] static void ginARGB (juce::Image& img, unsigned int radius)
+    // The horizontal pass over rows [firstRow, lastRow)
+    // radius must already be clamped to 2-254
+    [[maybe_unused]] static void ginARGBRows (const melatonin::blur::ImageView& data, unsigned int radius, unsigned int firstRow, unsigned int lastRow)
     {
-        const unsigned int w = (unsigned int) img.getWidth();
-        const unsigned int h = (unsigned int) img.getHeight();
-
-        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
-
-        radius = juce::jlimit (2u, 254u, radius);
+        const unsigned int w = (unsigned int) data.width;
 
         unsigned char stack[(254 * 2 + 1) * 4];
 
-        unsigned int x, y, xp, yp, i, sp, stack_start;
+        unsigned int x, y, xp, i, sp, stack_start;
 
         unsigned char* stack_ptr = nullptr;
         unsigned char* src_ptr = nullptr;
@@ -233,19 +229,17 @@ namespace melatonin::stackBlur
             sum_out_r, sum_out_g, sum_out_b, sum_out_a;
 
         unsigned int wm = w - 1;
-        unsigned int hm = h - 1;
-        unsigned int w4 = (unsigned int) data.lineStride;
         unsigned int div = (unsigned int) (radius * 2) + 1;
         unsigned int mul_sum = stackBlur::stackblur_mul[radius];
         unsigned char shr_sum = stackBlur::stackblur_shr[radius];
 
-        for (y = 0; y < h; ++y)
+        for (y = firstRow; y < lastRow; ++y)
         {
             sum_r = sum_g = sum_b = sum_a =
                 sum_in_r = sum_in_g = sum_in_b = sum_in_a =
                     sum_out_r = sum_out_g = sum_out_b = sum_out_a = 0;
 
-            src_ptr = data.getLinePointer (int (y));
+            src_ptr = data.getLinePointer (y);
 
             for (i = 0; i <= radius; ++i)
             {
@@ -289,8 +283,8 @@ namespace melatonin::stackBlur
             if (xp > wm)
                 xp = wm;
 
-            src_ptr = data.getLinePointer (int (y)) + (unsigned int) data.pixelStride * xp;
-            dst_ptr = data.getLinePointer (int (y));
+            src_ptr = data.getLinePointer (y) + (unsigned int) data.pixelStride * xp;
+            dst_ptr = data.getLinePointer (y);
 
             for (x = 0; x < w; ++x)
             {
@@ -353,8 +347,31 @@ namespace melatonin::stackBlur
                 sum_in_a -= stack_ptr[3];
             }
         }
+    }
 
-        for (x = 0; x < w; ++x)
+    // The vertical pass over columns [firstColumn, lastColumn)
+    [[maybe_unused]] static void ginARGBColumns (const melatonin::blur::ImageView& data, unsigned int radius, unsigned int firstColumn, unsigned int lastColumn)
+    {
+        const unsigned int h = (unsigned int) data.height;
+
+        unsigned char stack[(254 * 2 + 1) * 4];
+
+        unsigned int x, y, yp, i, sp, stack_start;
+
+        unsigned char* stack_ptr = nullptr;
+        unsigned char* src_ptr = nullptr;
+        unsigned char* dst_ptr = nullptr;
+
+        unsigned long sum_r, sum_g, sum_b, sum_a, sum_in_r, sum_in_g, sum_in_b, sum_in_a,
+            sum_out_r, sum_out_g, sum_out_b, sum_out_a;
+
+        unsigned int hm = h - 1;
+        unsigned int w4 = (unsigned int) data.lineStride;
+        unsigned int div = (unsigned int) (radius * 2) + 1;
+        unsigned int mul_sum = stackBlur::stackblur_mul[radius];
+        unsigned char shr_sum = stackBlur::stackblur_shr[radius];
+
+        for (x = firstColumn; x < lastColumn; ++x)
         {
             sum_r = sum_g = sum_b = sum_a =
                 sum_in_r = sum_in_g = sum_in_b = sum_in_a =
@@ -404,7 +421,7 @@ namespace melatonin::stackBlur
             if (yp > hm)
                 yp = hm;
 
-            src_ptr = data.getLinePointer (int (yp)) + (unsigned int) data.pixelStride * x;
+            src_ptr = data.getLinePointer (yp) + (unsigned int) data.pixelStride * x;
             dst_ptr = data.getLinePointer (0) + (unsigned int) data.pixelStride * x;
 
             for (y = 0; y < h; ++y)
@@ -468,6 +485,25 @@ namespace melatonin::stackBlur
             }
         }
     }
+    static void ginSingleChannel (juce::Image& img, unsigned int radius)
+    {
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        ginSingleChannel (melatonin::blur::viewOf (data), radius);
+    }
+
+    [[maybe_unused]] static void ginARGB (const melatonin::blur::ImageView& data, unsigned int radius)
+    {
+        radius = juce::jlimit (2u, 254u, radius);
+
+        ginARGBRows (data, radius, 0, (unsigned int) data.height);
+        ginARGBColumns (data, radius, 0, (unsigned int) data.width);
+    }
+
+    [[maybe_unused]] static void ginARGB (juce::Image& img, unsigned int radius)
+    {
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        ginARGB (melatonin::blur::viewOf (data), radius);
+    }
 
     // these are sudara's old helpers
     static void renderDropShadow (juce::Graphics& g, const juce::Path& path, juce::Colour color, const int radius = 1, const juce::Point<int> offset = { 0, 0 }, int spread = 0)
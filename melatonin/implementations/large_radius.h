@@ -0,0 +1,181 @@
+#pragma once
+#include "../internal/cache_strips.h"
+#include "../internal/scratch.h"
+#include "../internal/source_and_destination.h"
+#include "../internal/transpose.h"
+#include "juce_graphics/juce_graphics.h"
+
+/*
+ * Stack blur for radii past 254.
+ *
+ * Gin's lookup tables (and the sums in the vector implementations) stop at 254,
+ * which a 100px shadow passes at 3x scale.
+ *
+ * A stack blur's triangular kernel is two box blurs of width radius + 1 in a row:
+ * one looking back from the pixel and one looking forward.
+ * Each box is a running sum, so nothing here keeps a queue or cares how big the radius is.
+ * It's O(1) per pixel: 4 reads and a handful of adds and multiplies.
+ *
+ * The second box has to see the first box's output past the image edges.
+ * Rather than storing it, we keep two running copies of the first box
+ * (one leading, one trailing) straight from the (edge-clamped) input.
+ * That makes the result the exact stack blur, edges included, truncated like the float implementations.
+ *
+ * The sums are 32 bit up to maxLargeRadius, and 64 bit (a bit slower) past it, so no radius is clamped.
+ */
+namespace melatonin::blur
+{
+    // Everything at or below this goes to the regular stack blur implementations
+    static constexpr size_t maxStackBlurRadius = 254;
+
+    // The largest radius with 32 bit sums: 256 * (radius + 1)^2 has to fit
+    static constexpr size_t maxLargeRadius = 4094;
+
+    // One pass over `length` lines of `numLanes` independent 8 bit values, progressing downwards
+    // It needs the untouched input the whole way, so src and dst must be different
+    // Sum is uint32_t up to maxLargeRadius and uint64_t past it
+    template <typename Sum>
+    static inline void largeRadiusPass (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t numLanes, size_t length, size_t radius, Sum* leading, Sum* trailing, Sum* triangle)
+    {
+        const auto lastLine = (std::ptrdiff_t) length - 1;
+        auto line = [&] (std::ptrdiff_t index) { return src + (size_t) juce::jlimit ((std::ptrdiff_t) 0, lastLine, index) * srcLineStride; };
+        const auto r = (std::ptrdiff_t) radius;
+
+        const auto divisor = (Sum) ((radius + 1) * (radius + 1));
+        const auto halfReciprocal = 2.0f / (float) divisor;
+
+        // the first box, ending on line 0, is just the top pixel repeated
+        for (size_t i = 0; i < numLanes; ++i)
+        {
+            trailing[i] = (Sum) (line (0)[i] * (radius + 1));
+            leading[i] = trailing[i];
+            triangle[i] = trailing[i];
+        }
+
+        // slide the leading box down to line r, summing the boxes into the triangle
+        for (std::ptrdiff_t k = 1; k <= r; ++k)
+        {
+            auto incoming = line (k);
+            auto outgoing = line (k - r - 1);
+            for (size_t i = 0; i < numLanes; ++i)
+            {
+                leading[i] += (Sum) incoming[i] - (Sum) outgoing[i];
+                triangle[i] += leading[i];
+            }
+        }
+
+        for (std::ptrdiff_t x = 0; x <= lastLine; ++x)
+        {
+            auto out = dst + (size_t) x * dstLineStride;
+            auto leadingIn = line (x + r + 1);
+            auto leadingOut = line (x);
+            auto trailingIn = line (x + 1);
+            auto trailingOut = line (x - r);
+
+            // simple loops vectorize, one combined loop doesn't (too many pointers that might alias)
+            for (size_t i = 0; i < numLanes; ++i)
+            {
+                // SSE2 can only convert signed ints to float, so the estimate works on half the sum
+                // (64 bit sums don't fit, those are estimated in double)
+                // It can be off by one either way, which the integer checks fix
+                Sum blurred;
+                if constexpr (sizeof (Sum) == sizeof (uint32_t))
+                    blurred = (Sum) (int32_t) ((float) (int32_t) (triangle[i] >> 1) * halfReciprocal);
+                else
+                    blurred = (Sum) ((double) triangle[i] / (double) divisor);
+                blurred -= (Sum) (blurred * divisor > triangle[i]);
+                blurred += (Sum) ((blurred + 1) * divisor <= triangle[i]);
+                out[i] = (uint8_t) blurred;
+            }
+
+            // unsigned wraparound is fine, the sums themselves never go negative
+            for (size_t i = 0; i < numLanes; ++i)
+                leading[i] += (Sum) leadingIn[i] - (Sum) leadingOut[i];
+
+            for (size_t i = 0; i < numLanes; ++i)
+            {
+                triangle[i] += leading[i] - trailing[i];
+                trailing[i] += (Sum) trailingIn[i] - (Sum) trailingOut[i];
+            }
+        }
+    }
+
+    // There's no queue, so strips are only needed to split the work across threads
+    template <typename Sum>
+    static inline void largeRadiusStripedPass (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t numLanes, size_t length, size_t radius, size_t numTasks)
+    {
+        forEachStrip (numLanes, 3 * sizeof (Sum), numTasks, [&] (size_t x, size_t columns) {
+            ScratchFrame scratch;
+            auto leading = scratch.allocate<Sum> (columns);
+            auto trailing = scratch.allocate<Sum> (columns);
+            auto triangle = scratch.allocate<Sum> (columns);
+            largeRadiusPass (src + x, srcLineStride, dst + x, dstLineStride, columns, length, radius, leading, trailing, triangle);
+        });
+    }
+
+    static inline void largeRadiusStripedPass (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t numLanes, size_t length, size_t radius, size_t numTasks)
+    {
+        if (radius <= maxLargeRadius)
+            largeRadiusStripedPass<uint32_t> (src, srcLineStride, dst, dstLineStride, numLanes, length, radius, numTasks);
+        else
+            largeRadiusStripedPass<uint64_t> (src, srcLineStride, dst, dstLineStride, numLanes, length, radius, numTasks);
+    }
+
+    // Every byte is its own lane, so single channel and ARGB only differ in how they transpose
+    // Reads from src and writes to dst (which can be the same view)
+    template <typename Pixel>
+    static void largeRadiusStackBlur (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        SourceAndDestination images (src, dst);
+        const auto w = images.width();
+        const auto h = images.height();
+        jassert (images.pixelStride() == sizeof (Pixel));
+
+        radius = juce::jmax ((size_t) 1, radius);
+
+        const auto numTasks = parallelTasksFor (w * h);
+        const auto rowBytes = w * sizeof (Pixel);
+        const auto columnBytes = h * sizeof (Pixel);
+        ScratchFrame scratch;
+        auto input = scratch.allocate<uint8_t> (rowBytes * h);
+        auto output = scratch.allocate<uint8_t> (rowBytes * h);
+
+        // HORIZONTAL PASS: rows become columns, so the pass can do them all at once
+        transpose<Pixel> (images.source(), images.sourceLineStride(), input, columnBytes, w, h, numTasks);
+        largeRadiusStripedPass (input, columnBytes, output, columnBytes, columnBytes, w, radius, numTasks);
+
+        // the horizontal pass goes back as rows into scratch rather than into dst,
+        // so the vertical pass can read from it and write straight into the image
+        transpose<Pixel> (output, columnBytes, input, rowBytes, h, w, numTasks);
+
+        // VERTICAL PASS
+        largeRadiusStripedPass (input, rowBytes, images.destination(), images.destinationLineStride(), rowBytes, h, radius, numTasks);
+    }
+
+    [[maybe_unused]] static void largeRadiusSingleChannel (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        largeRadiusStackBlur<uint8_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void largeRadiusSingleChannel (juce::Image& img, size_t radius)
+    {
+        MappedImages images (img, img);
+        largeRadiusStackBlur<uint8_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void largeRadiusARGB (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        largeRadiusStackBlur<uint32_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void largeRadiusARGB (const juce::Image& src, juce::Image& dst, size_t radius)
+    {
+        MappedImages images (src, dst);
+        largeRadiusStackBlur<uint32_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void largeRadiusARGB (juce::Image& img, size_t radius)
+    {
+        largeRadiusARGB (img, img, radius);
+    }
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include "../internal/cache_strips.h"
+#include "../internal/scratch.h"
+#include "../internal/source_and_destination.h"
+#include "../internal/transpose.h"
+#include "juce_graphics/juce_graphics.h"
+#include <array>
+
+/*
+ * Recursive (IIR) Gaussian blur.
+ * See Young and van Vliet, "Recursive implementation of the Gaussian filter" (1995)
+ *
+ * Each line is filtered forwards and then backwards by a 3rd order recursive filter.
+ * Together they approximate a Gaussian, and the cost doesn't depend on sigma at all.
+ * Each filter only looks back at its previous 3 outputs, no queue of 2 * radius + 1 values,
+ * but the backward filter runs over the forward results, so a pass keeps them as floats:
+ * one line of scratch per line filtered.
+ *
+ * The edges are replicated, like the stack blurs. The backward pass starts where the forward pass
+ * would have ended up past the last line, see Triggs and Sdika,
+ * "Boundary conditions for Young-van Vliet recursive filtering" (2006)
+ *
+ * Like the other vector implementations, a pass runs down whole rows at once (the loops vectorize)
+ * and the horizontal pass transposes the image first.
+ */
+namespace melatonin::blur
+{
+    struct RecursiveGaussianCoefficients
+    {
+        float gain; // B in the paper
+        float feedback[3]; // b1 / b0, b2 / b0, b3 / b0
+
+        // maps how far the last 3 forward outputs are from the edge pixel
+        // to how far the 3 backward outputs past the end are from it
+        float boundary[3][3];
+    };
+
+    // Past the last line the input is the edge pixel forever, so (relative to it) the forward filter
+    // just decays from its last 3 outputs. Its state s moves on by the companion matrix A, and the
+    // backward filter's output at any line is some fixed c · s with c = B e1 + c (b1 A + b2 A² + b3 A³)
+    // That's a 3x3 solve for c, and the outputs past the end are c A, c A² and c A³
+    [[nodiscard]] static inline RecursiveGaussianCoefficients withBoundary (RecursiveGaussianCoefficients c)
+    {
+        using Row = std::array<double, 3>;
+        const Row f { c.feedback[0], c.feedback[1], c.feedback[2] };
+        auto timesA = [&] (const Row& r) { return Row { r[0] * f[0] + r[1], r[0] * f[1] + r[2], r[0] * f[2] }; };
+
+        // m[row][i] is row i of (I - b1 A - b2 A² - b3 A³), transposed
+        double m[3][3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            Row basis {};
+            basis[i] = 1.0;
+            const auto a1 = timesA (basis);
+            const auto a2 = timesA (a1);
+            const auto a3 = timesA (a2);
+            for (size_t row = 0; row < 3; ++row)
+                m[row][i] = basis[row] - (f[0] * a1[row] + f[1] * a2[row] + f[2] * a3[row]);
+        }
+
+        auto determinant = [] (const double (&d)[3][3]) {
+            return d[0][0] * (d[1][1] * d[2][2] - d[1][2] * d[2][1])
+                   - d[0][1] * (d[1][0] * d[2][2] - d[1][2] * d[2][0])
+                   + d[0][2] * (d[1][0] * d[2][1] - d[1][1] * d[2][0]);
+        };
+
+        // Cramer's rule, the right hand side is (B, 0, 0)
+        const auto det = determinant (m);
+        Row solution {};
+        for (size_t i = 0; i < 3; ++i)
+        {
+            double replaced[3][3];
+            for (size_t row = 0; row < 3; ++row)
+                for (size_t col = 0; col < 3; ++col)
+                    replaced[row][col] = col == i ? (row == 0 ? (double) c.gain : 0.0) : m[row][col];
+            solution[i] = determinant (replaced) / det;
+        }
+
+        auto power = timesA (solution);
+        for (auto& line : c.boundary)
+        {
+            for (size_t i = 0; i < 3; ++i)
+                line[i] = (float) power[i];
+            power = timesA (power);
+        }
+        return c;
+    }
+
+    [[nodiscard]] static inline RecursiveGaussianCoefficients recursiveGaussianCoefficientsFor (float sigma)
+    {
+        sigma = juce::jmax (0.5f, sigma);
+
+        const auto q = sigma >= 2.5f
+                           ? 0.98711f * sigma - 0.96330f
+                           : 3.97156f - 4.14554f * std::sqrt (1.0f - 0.26891f * sigma);
+        const auto q2 = q * q;
+        const auto q3 = q2 * q;
+
+        const auto b0 = 1.57825f + 2.44413f * q + 1.4281f * q2 + 0.422205f * q3;
+        const auto b1 = 2.44413f * q + 2.85619f * q2 + 1.26661f * q3;
+        const auto b2 = -(1.4281f * q2 + 1.26661f * q3);
+        const auto b3 = 0.422205f * q3;
+
+        return withBoundary ({ 1.0f - (b1 + b2 + b3) / b0, { b1 / b0, b2 / b0, b3 / b0 }, {} });
+    }
+
+    // Forwards and backwards over `length` lines of `numLanes` independent values
+    // buffer holds (length + 3) * numLanes floats, the forward results and 3 lines past the end
+    static inline void recursiveGaussianPass (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, RecursiveGaussianCoefficients c, float* buffer)
+    {
+        const auto lastLine = length - 1;
+        auto bufferLine = [&] (size_t index) { return buffer + index * numLanes; };
+
+        // B + b1 + b2 + b3 is 1, so each output is written as the previous one plus weighted differences
+        // Same filter, but a constant run stays exactly constant: with a large sigma B is tiny,
+        // and rounding in the plain form adds up to whole levels
+
+        // FORWARDS: before the first line, pretend the edge pixel goes on forever
+        // That's a constant input, already at steady state, so the first output is the edge pixel itself
+        for (size_t i = 0; i < numLanes; ++i)
+            buffer[i] = (float) data[i];
+
+        for (size_t x = 1; x < length; ++x)
+        {
+            auto in = data + x * lineStride;
+            auto out = bufferLine (x);
+            auto previous1 = bufferLine (x - 1);
+            auto previous2 = bufferLine (x >= 2 ? x - 2 : 0);
+            auto previous3 = bufferLine (x >= 3 ? x - 3 : 0);
+
+            for (size_t i = 0; i < numLanes; ++i)
+                out[i] = previous1[i] + c.gain * ((float) in[i] - previous1[i]) + c.feedback[1] * (previous2[i] - previous1[i]) + c.feedback[2] * (previous3[i] - previous1[i]);
+        }
+
+        // BACKWARDS: after the last line the edge pixel goes on forever again
+        // but the forward filter hasn't settled on it yet, so start from where it would end up
+        {
+            const auto edge = data + lastLine * lineStride;
+            const float* last[3] = { bufferLine (lastLine), bufferLine (lastLine >= 1 ? lastLine - 1 : 0), bufferLine (lastLine >= 2 ? lastLine - 2 : 0) };
+            for (size_t past = 0; past < 3; ++past)
+            {
+                auto out = bufferLine (length + past);
+                const auto& m = c.boundary[past];
+                for (size_t i = 0; i < numLanes; ++i)
+                {
+                    const auto u = (float) edge[i];
+                    out[i] = u + m[0] * (last[0][i] - u) + m[1] * (last[1][i] - u) + m[2] * (last[2][i] - u);
+                }
+            }
+        }
+
+        // then the same filter again from the bottom, overwriting the forward results in place
+        for (size_t x = length; x-- > 0;)
+        {
+            auto line = bufferLine (x);
+            auto next1 = bufferLine (x + 1);
+            auto next2 = bufferLine (x + 2);
+            auto next3 = bufferLine (x + 3);
+
+            for (size_t i = 0; i < numLanes; ++i)
+                line[i] = next1[i] + c.gain * (line[i] - next1[i]) + c.feedback[1] * (next2[i] - next1[i]) + c.feedback[2] * (next3[i] - next1[i]);
+
+            // the filter rings a little, so it can slightly overshoot either end
+            auto out = data + x * lineStride;
+            for (size_t i = 0; i < numLanes; ++i)
+                out[i] = (uint8_t) juce::jlimit (0.0f, 255.0f, line[i] + 0.5f);
+        }
+    }
+
+    static inline void recursiveGaussianStripedPass (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, RecursiveGaussianCoefficients coefficients, size_t numTasks)
+    {
+        // per column: the forward results and 3 values past the end
+        forEachStrip (numLanes, (length + 3) * sizeof (float), numTasks, [&] (size_t x, size_t columns) {
+            ScratchFrame scratch;
+            recursiveGaussianPass (data + x, lineStride, columns, length, coefficients, scratch.allocate<float> (columns * (length + 3)));
+        });
+    }
+
+    // sigma is radius / 2, like CSS and Figma
+    // Every byte is its own lane, so single channel and ARGB only differ in how they transpose
+    // Reads from src and writes to dst (which can be the same view)
+    template <typename Pixel>
+    static void recursiveGaussian (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        SourceAndDestination images (src, dst);
+        const auto w = images.width();
+        const auto h = images.height();
+        jassert (images.pixelStride() == sizeof (Pixel));
+
+        const auto coefficients = recursiveGaussianCoefficientsFor ((float) radius / 2.0f);
+        const auto numTasks = parallelTasksFor (w * h);
+
+        // HORIZONTAL PASS: rows become columns, so the pass can do them all at once
+        const auto columnBytes = h * sizeof (Pixel);
+        ScratchFrame scratch;
+        auto transposed = scratch.allocate<uint8_t> (columnBytes * w);
+        transpose<Pixel> (images.source(), images.sourceLineStride(), transposed, columnBytes, w, h, numTasks);
+        recursiveGaussianStripedPass (transposed, columnBytes, columnBytes, w, coefficients, numTasks);
+        transpose<Pixel> (transposed, columnBytes, images.destination(), images.destinationLineStride(), h, w, numTasks);
+
+        // VERTICAL PASS
+        recursiveGaussianStripedPass (images.destination(), images.destinationLineStride(), w * sizeof (Pixel), h, coefficients, numTasks);
+    }
+
+    [[maybe_unused]] static void recursiveGaussianSingleChannel (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        recursiveGaussian<uint8_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void recursiveGaussianSingleChannel (juce::Image& img, size_t radius)
+    {
+        MappedImages images (img, img);
+        recursiveGaussian<uint8_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void recursiveGaussianARGB (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        recursiveGaussian<uint32_t> (src, dst, radius);
+    }
+
+    [[maybe_unused]] static void recursiveGaussianARGB (const juce::Image& src, juce::Image& dst, size_t radius)
+    {
+        MappedImages images (src, dst);
+        recursiveGaussian<uint32_t> (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void recursiveGaussianARGB (juce::Image& img, size_t radius)
+    {
+        recursiveGaussianARGB (img, img, radius);
+    }
+}
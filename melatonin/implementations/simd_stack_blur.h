@@ -0,0 +1,474 @@
+#pragma once
+#include "../internal/cache_strips.h"
+#include "../internal/scratch.h"
+#include "../internal/source_and_destination.h"
+#include "../internal/transpose.h"
+#include "gin.h"
+#include "juce_graphics/juce_graphics.h"
+#include <array>
+#include <immintrin.h>
+#include <utility>
+
+/*
+ * Hand-vectorized stack blur for x86 (Linux and Windows without IPP).
+ *
+ * The kernel is the same column-at-once stack blur as juceFloatVectorSingleChannel,
+ * but every step (output, queue rotation, u8 <-> float conversion) is fused
+ * into a single loop over the lanes, instead of 8+ separate passes over memory.
+ *
+ * There are two flavors:
+ *   simdFloatSingleChannel matches juceFloatVectorSingleChannel (float sums, truncated output)
+ *   simdSingleChannel matches ginSingleChannel (fixed point, no float conversion at all)
+ *
+ * simdARGB is the fixed point flavor on ARGB images and matches ginARGB.
+ *
+ * Radii up to 16 (most UI shadows) get their own fixed point pass, compiled once per radius,
+ * that keeps the sums in registers instead of reloading them on every line.
+ *
+ * It's compiled once per instruction set (SSE2, AVX2, AVX-512)
+ * and the best one for the running CPU is picked the first time it's used.
+ */
+
+#define MELATONIN_BLUR_STRINGIFY_(x) #x
+#define MELATONIN_BLUR_STRINGIFY(x) MELATONIN_BLUR_STRINGIFY_ (x)
+
+// Everything between BEGIN and END is compiled for the given instruction set
+// MSVC lets us use any intrinsic without target flags
+#if defined(__clang__)
+    #define MELATONIN_BLUR_BEGIN_TARGET(isa) _Pragma (MELATONIN_BLUR_STRINGIFY (clang attribute push (__attribute__ ((target (isa))), apply_to = function)))
+    #define MELATONIN_BLUR_END_TARGET _Pragma ("clang attribute pop")
+#elif defined(__GNUC__)
+    #define MELATONIN_BLUR_BEGIN_TARGET(isa) _Pragma ("GCC push_options") _Pragma (MELATONIN_BLUR_STRINGIFY (GCC target (isa)))
+    #define MELATONIN_BLUR_END_TARGET _Pragma ("GCC pop_options")
+#else
+    #define MELATONIN_BLUR_BEGIN_TARGET(isa)
+    #define MELATONIN_BLUR_END_TARGET
+#endif
+
+namespace melatonin::blur
+{
+    enum class SIMDInstructionSet {
+        sse2,
+        avx2,
+        avx512
+    };
+
+    namespace simd
+    {
+        // data, width, height, lineStride, radius
+        using SingleChannelKernel = void (*) (uint8_t*, size_t, size_t, size_t, size_t);
+
+        // src, srcLineStride, dst, dstLineStride, width, height, radius
+        using ARGBKernel = void (*) (const uint8_t*, size_t, uint8_t*, size_t, size_t, size_t, size_t);
+
+        // Radii up to this get a pass compiled for their exact radius
+        static constexpr size_t maxSmallRadius = 16;
+    }
+}
+
+MELATONIN_BLUR_BEGIN_TARGET ("sse2")
+namespace melatonin::blur::simd::sse2
+{
+    struct ISA
+    {
+        static constexpr size_t lanes = 4;
+        using Floats = __m128;
+
+        static inline Floats load (const float* p) { return _mm_loadu_ps (p); }
+        static inline void store (float* p, Floats v) { _mm_storeu_ps (p, v); }
+        static inline Floats set (float v) { return _mm_set1_ps (v); }
+        static inline Floats add (Floats a, Floats b) { return _mm_add_ps (a, b); }
+        static inline Floats sub (Floats a, Floats b) { return _mm_sub_ps (a, b); }
+        static inline Floats mul (Floats a, Floats b) { return _mm_mul_ps (a, b); }
+
+        // 4 uint8 -> 4 floats
+        static inline Floats loadBytes (const uint8_t* p)
+        {
+            int32_t packed;
+            memcpy (&packed, p, sizeof (packed));
+            auto zero = _mm_setzero_si128();
+            auto bytes = _mm_cvtsi32_si128 (packed);
+            return _mm_cvtepi32_ps (_mm_unpacklo_epi16 (_mm_unpacklo_epi8 (bytes, zero), zero));
+        }
+
+        // 4 floats -> 4 uint8 (truncated, like the scalar cast)
+        static inline void storeBytes (uint8_t* p, Floats v)
+        {
+            auto ints = _mm_cvttps_epi32 (v);
+            auto words = _mm_packs_epi32 (ints, ints);
+            auto packed = _mm_cvtsi128_si32 (_mm_packus_epi16 (words, words));
+            memcpy (p, &packed, sizeof (packed));
+        }
+
+        // Integer kernel: sumIn/sumOut are uint16, the stack sum is uint32
+        static constexpr size_t intLanes = 8;
+        using Words = __m128i;
+        struct Sums
+        {
+            __m128i low, high;
+        };
+
+        // 8 uint8 -> 8 uint16
+        static inline Words loadBytesAsWords (const uint8_t* p)
+        {
+            return _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*) p), _mm_setzero_si128());
+        }
+
+        static inline Words zeroWords() { return _mm_setzero_si128(); }
+        static inline Words loadWords (const uint16_t* p) { return _mm_loadu_si128 ((const __m128i*) p); }
+        static inline void storeWords (uint16_t* p, Words v) { _mm_storeu_si128 ((__m128i*) p, v); }
+        static inline Words addWords (Words a, Words b) { return _mm_add_epi16 (a, b); }
+        static inline Words subWords (Words a, Words b) { return _mm_sub_epi16 (a, b); }
+
+        static inline Sums zeroSums() { return { _mm_setzero_si128(), _mm_setzero_si128() }; }
+
+        static inline Sums loadSums (const uint32_t* p)
+        {
+            return { _mm_loadu_si128 ((const __m128i*) p), _mm_loadu_si128 ((const __m128i*) (p + 4)) };
+        }
+
+        static inline void storeSums (uint32_t* p, Sums v)
+        {
+            _mm_storeu_si128 ((__m128i*) p, v.low);
+            _mm_storeu_si128 ((__m128i*) (p + 4), v.high);
+        }
+
+        static inline Sums addSums (Sums a, Words b)
+        {
+            auto zero = _mm_setzero_si128();
+            return { _mm_add_epi32 (a.low, _mm_unpacklo_epi16 (b, zero)), _mm_add_epi32 (a.high, _mm_unpackhi_epi16 (b, zero)) };
+        }
+
+        static inline Sums subSums (Sums a, Words b)
+        {
+            auto zero = _mm_setzero_si128();
+            return { _mm_sub_epi32 (a.low, _mm_unpacklo_epi16 (b, zero)), _mm_sub_epi32 (a.high, _mm_unpackhi_epi16 (b, zero)) };
+        }
+
+        // SSE2 has no 32 bit mullo, so multiply the even and odd lanes separately
+        static inline __m128i multiply (__m128i a, __m128i b)
+        {
+            auto even = _mm_mul_epu32 (a, b);
+            auto odd = _mm_mul_epu32 (_mm_srli_epi64 (a, 32), _mm_srli_epi64 (b, 32));
+            return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2, 0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+        }
+
+        // (sum * mul) >> shr, exactly like gin, then 8 uint32 -> 8 uint8
+        static inline void storeAverage (uint8_t* p, Sums sums, uint32_t mul, uint32_t shr)
+        {
+            auto multiplier = _mm_set1_epi32 ((int) mul);
+            auto shift = _mm_cvtsi32_si128 ((int) shr);
+            auto low = _mm_srl_epi32 (multiply (sums.low, multiplier), shift);
+            auto high = _mm_srl_epi32 (multiply (sums.high, multiplier), shift);
+            auto words = _mm_packs_epi32 (low, high);
+            _mm_storel_epi64 ((__m128i*) p, _mm_packus_epi16 (words, words));
+        }
+    };
+
+#include "simd_stack_blur_kernels.h"
+}
+MELATONIN_BLUR_END_TARGET
+
+MELATONIN_BLUR_BEGIN_TARGET ("avx2")
+namespace melatonin::blur::simd::avx2
+{
+    struct ISA
+    {
+        static constexpr size_t lanes = 8;
+        using Floats = __m256;
+
+        static inline Floats load (const float* p) { return _mm256_loadu_ps (p); }
+        static inline void store (float* p, Floats v) { _mm256_storeu_ps (p, v); }
+        static inline Floats set (float v) { return _mm256_set1_ps (v); }
+        static inline Floats add (Floats a, Floats b) { return _mm256_add_ps (a, b); }
+        static inline Floats sub (Floats a, Floats b) { return _mm256_sub_ps (a, b); }
+        static inline Floats mul (Floats a, Floats b) { return _mm256_mul_ps (a, b); }
+
+        // 8 uint8 -> 8 floats
+        static inline Floats loadBytes (const uint8_t* p)
+        {
+            return _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i*) p)));
+        }
+
+        // 8 floats -> 8 uint8 (truncated, like the scalar cast)
+        static inline void storeBytes (uint8_t* p, Floats v)
+        {
+            auto ints = _mm256_cvttps_epi32 (v);
+
+            // packs work within each 128 bit half, so we end up with 4 bytes in each half
+            auto words = _mm256_packs_epi32 (ints, ints);
+            auto bytes = _mm256_packus_epi16 (words, words);
+            auto joined = _mm_unpacklo_epi32 (_mm256_castsi256_si128 (bytes), _mm256_extracti128_si256 (bytes, 1));
+            _mm_storel_epi64 ((__m128i*) p, joined);
+        }
+
+        // Integer kernel: sumIn/sumOut are uint16, the stack sum is uint32
+        static constexpr size_t intLanes = 16;
+        using Words = __m256i;
+        struct Sums
+        {
+            __m256i low, high;
+        };
+
+        // 16 uint8 -> 16 uint16
+        static inline Words loadBytesAsWords (const uint8_t* p)
+        {
+            return _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*) p));
+        }
+
+        static inline Words zeroWords() { return _mm256_setzero_si256(); }
+        static inline Words loadWords (const uint16_t* p) { return _mm256_loadu_si256 ((const __m256i*) p); }
+        static inline void storeWords (uint16_t* p, Words v) { _mm256_storeu_si256 ((__m256i*) p, v); }
+        static inline Words addWords (Words a, Words b) { return _mm256_add_epi16 (a, b); }
+        static inline Words subWords (Words a, Words b) { return _mm256_sub_epi16 (a, b); }
+
+        static inline Sums zeroSums() { return { _mm256_setzero_si256(), _mm256_setzero_si256() }; }
+
+        static inline Sums loadSums (const uint32_t* p)
+        {
+            return { _mm256_loadu_si256 ((const __m256i*) p), _mm256_loadu_si256 ((const __m256i*) (p + 8)) };
+        }
+
+        static inline void storeSums (uint32_t* p, Sums v)
+        {
+            _mm256_storeu_si256 ((__m256i*) p, v.low);
+            _mm256_storeu_si256 ((__m256i*) (p + 8), v.high);
+        }
+
+        static inline Sums addSums (Sums a, Words b)
+        {
+            return { _mm256_add_epi32 (a.low, _mm256_cvtepu16_epi32 (_mm256_castsi256_si128 (b))),
+                _mm256_add_epi32 (a.high, _mm256_cvtepu16_epi32 (_mm256_extracti128_si256 (b, 1))) };
+        }
+
+        static inline Sums subSums (Sums a, Words b)
+        {
+            return { _mm256_sub_epi32 (a.low, _mm256_cvtepu16_epi32 (_mm256_castsi256_si128 (b))),
+                _mm256_sub_epi32 (a.high, _mm256_cvtepu16_epi32 (_mm256_extracti128_si256 (b, 1))) };
+        }
+
+        // (sum * mul) >> shr, exactly like gin, then 16 uint32 -> 16 uint8
+        static inline void storeAverage (uint8_t* p, Sums sums, uint32_t mul, uint32_t shr)
+        {
+            auto multiplier = _mm256_set1_epi32 ((int) mul);
+            auto shift = _mm_cvtsi32_si128 ((int) shr);
+            auto low = _mm256_srl_epi32 (_mm256_mullo_epi32 (sums.low, multiplier), shift);
+            auto high = _mm256_srl_epi32 (_mm256_mullo_epi32 (sums.high, multiplier), shift);
+
+            // packs work within each 128 bit half, so put the quarters back in order
+            auto words = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (low, high), _MM_SHUFFLE (3, 1, 2, 0));
+            _mm_storeu_si128 ((__m128i*) p, _mm_packus_epi16 (_mm256_castsi256_si128 (words), _mm256_extracti128_si256 (words, 1)));
+        }
+    };
+
+#include "simd_stack_blur_kernels.h"
+}
+MELATONIN_BLUR_END_TARGET
+
+MELATONIN_BLUR_BEGIN_TARGET ("avx512f,avx2")
+// GCC 12 trips over the _mm512_undefined_* placeholders inside its own intrinsics
+JUCE_BEGIN_IGNORE_WARNINGS_GCC_LIKE ("-Wmaybe-uninitialized")
+namespace melatonin::blur::simd::avx512
+{
+    struct ISA
+    {
+        static constexpr size_t lanes = 16;
+        using Floats = __m512;
+
+        static inline Floats load (const float* p) { return _mm512_loadu_ps (p); }
+        static inline void store (float* p, Floats v) { _mm512_storeu_ps (p, v); }
+        static inline Floats set (float v) { return _mm512_set1_ps (v); }
+        static inline Floats add (Floats a, Floats b) { return _mm512_add_ps (a, b); }
+        static inline Floats sub (Floats a, Floats b) { return _mm512_sub_ps (a, b); }
+        static inline Floats mul (Floats a, Floats b) { return _mm512_mul_ps (a, b); }
+
+        // 16 uint8 -> 16 floats
+        static inline Floats loadBytes (const uint8_t* p)
+        {
+            return _mm512_cvtepi32_ps (_mm512_cvtepu8_epi32 (_mm_loadu_si128 ((const __m128i*) p)));
+        }
+
+        // 16 floats -> 16 uint8 (truncated, like the scalar cast)
+        static inline void storeBytes (uint8_t* p, Floats v)
+        {
+            _mm_storeu_si128 ((__m128i*) p, _mm512_cvtepi32_epi8 (_mm512_cvttps_epi32 (v)));
+        }
+
+        // Integer kernel: sumIn/sumOut are uint16, the stack sum is uint32
+        // 16 bit math on 512 bit registers needs AVX512BW, so the words stay in 256 bit AVX2 registers
+        static constexpr size_t intLanes = 16;
+        using Words = __m256i;
+        using Sums = __m512i;
+
+        // 16 uint8 -> 16 uint16
+        static inline Words loadBytesAsWords (const uint8_t* p)
+        {
+            return _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i*) p));
+        }
+
+        static inline Words zeroWords() { return _mm256_setzero_si256(); }
+        static inline Words loadWords (const uint16_t* p) { return _mm256_loadu_si256 ((const __m256i*) p); }
+        static inline void storeWords (uint16_t* p, Words v) { _mm256_storeu_si256 ((__m256i*) p, v); }
+        static inline Words addWords (Words a, Words b) { return _mm256_add_epi16 (a, b); }
+        static inline Words subWords (Words a, Words b) { return _mm256_sub_epi16 (a, b); }
+
+        static inline Sums zeroSums() { return _mm512_setzero_si512(); }
+        static inline Sums loadSums (const uint32_t* p) { return _mm512_loadu_si512 (p); }
+        static inline void storeSums (uint32_t* p, Sums v) { _mm512_storeu_si512 (p, v); }
+        static inline Sums addSums (Sums a, Words b) { return _mm512_add_epi32 (a, _mm512_cvtepu16_epi32 (b)); }
+        static inline Sums subSums (Sums a, Words b) { return _mm512_sub_epi32 (a, _mm512_cvtepu16_epi32 (b)); }
+
+        // (sum * mul) >> shr, exactly like gin, then 16 uint32 -> 16 uint8
+        static inline void storeAverage (uint8_t* p, Sums sums, uint32_t mul, uint32_t shr)
+        {
+            auto average = _mm512_srl_epi32 (_mm512_mullo_epi32 (sums, _mm512_set1_epi32 ((int) mul)), _mm_cvtsi32_si128 ((int) shr));
+            _mm_storeu_si128 ((__m128i*) p, _mm512_cvtepi32_epi8 (average));
+        }
+    };
+
+#include "simd_stack_blur_kernels.h"
+}
+JUCE_END_IGNORE_WARNINGS_GCC_LIKE
+MELATONIN_BLUR_END_TARGET
+
+namespace melatonin::blur
+{
+    namespace simd
+    {
+        static inline SIMDInstructionSet detectInstructionSet()
+        {
+            if (juce::SystemStats::hasAVX512F())
+                return SIMDInstructionSet::avx512;
+
+            if (juce::SystemStats::hasAVX2())
+                return SIMDInstructionSet::avx2;
+
+            // every x86-64 CPU has SSE2
+            return SIMDInstructionSet::sse2;
+        }
+    }
+
+    // The instruction set is checked once, the first time a blur runs
+    [[nodiscard]] static inline SIMDInstructionSet activeInstructionSet()
+    {
+        static const auto instructionSet = simd::detectInstructionSet();
+        return instructionSet;
+    }
+
+    // Handy for logging and benchmarks
+    [[maybe_unused]] [[nodiscard]] static inline const char* activeInstructionSetName()
+    {
+        switch (activeInstructionSet())
+        {
+            case SIMDInstructionSet::avx512:
+                return "AVX-512";
+            case SIMDInstructionSet::avx2:
+                return "AVX2";
+            case SIMDInstructionSet::sse2:
+            default:
+                return "SSE2";
+        }
+    }
+
+    [[maybe_unused]] static void simdFloatSingleChannel (const ImageView& img, size_t radius)
+    {
+        jassert (img.pixelStride == 1);
+
+        // Ensure radius is within bounds
+        radius = juce::jlimit ((size_t) 1, (size_t) 254, radius);
+
+        static const simd::SingleChannelKernel kernel = [] {
+            switch (activeInstructionSet())
+            {
+                case SIMDInstructionSet::avx512:
+                    return &simd::avx512::floatSingleChannel;
+                case SIMDInstructionSet::avx2:
+                    return &simd::avx2::floatSingleChannel;
+                case SIMDInstructionSet::sse2:
+                default:
+                    return &simd::sse2::floatSingleChannel;
+            }
+        }();
+
+        kernel (img.data, img.width, img.height, img.lineStride, radius);
+    }
+
+    [[maybe_unused]] static void simdFloatSingleChannel (juce::Image& img, size_t radius)
+    {
+        jassert (img.getFormat() == juce::Image::SingleChannel);
+
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        simdFloatSingleChannel (viewOf (data), radius);
+    }
+
+    // Bit-exact with ginSingleChannel, so it can replace it without changing a single pixel
+    [[maybe_unused]] static void simdSingleChannel (const ImageView& img, size_t radius)
+    {
+        jassert (img.pixelStride == 1);
+
+        // Ensure radius is within bounds (same as gin)
+        radius = juce::jlimit ((size_t) 1, (size_t) 254, radius);
+
+        static const simd::SingleChannelKernel kernel = [] {
+            switch (activeInstructionSet())
+            {
+                case SIMDInstructionSet::avx512:
+                    return &simd::avx512::integerSingleChannel;
+                case SIMDInstructionSet::avx2:
+                    return &simd::avx2::integerSingleChannel;
+                case SIMDInstructionSet::sse2:
+                default:
+                    return &simd::sse2::integerSingleChannel;
+            }
+        }();
+
+        kernel (img.data, img.width, img.height, img.lineStride, radius);
+    }
+
+    [[maybe_unused]] static void simdSingleChannel (juce::Image& img, size_t radius)
+    {
+        jassert (img.getFormat() == juce::Image::SingleChannel);
+
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        simdSingleChannel (viewOf (data), radius);
+    }
+
+    // Bit-exact with ginARGB, at a fraction of the cost
+    // Reads from src and writes to dst (which can be the same view)
+    [[maybe_unused]] static void simdARGB (const ImageView& src, const ImageView& dst, size_t radius)
+    {
+        jassert (src.pixelStride == 4);
+
+        // Ensure radius is within bounds (same as gin)
+        radius = juce::jlimit ((size_t) 2, (size_t) 254, radius);
+
+        static const simd::ARGBKernel kernel = [] {
+            switch (activeInstructionSet())
+            {
+                case SIMDInstructionSet::avx512:
+                    return &simd::avx512::integerARGB;
+                case SIMDInstructionSet::avx2:
+                    return &simd::avx2::integerARGB;
+                case SIMDInstructionSet::sse2:
+                default:
+                    return &simd::sse2::integerARGB;
+            }
+        }();
+
+        SourceAndDestination images (src, dst);
+        kernel (images.source(), images.sourceLineStride(), images.destination(), images.destinationLineStride(), images.width(), images.height(), radius);
+    }
+
+    [[maybe_unused]] static void simdARGB (const juce::Image& src, juce::Image& dst, size_t radius)
+    {
+        jassert (src.getFormat() == juce::Image::ARGB);
+
+        MappedImages images (src, dst);
+        simdARGB (images.source(), images.destination(), radius);
+    }
+
+    [[maybe_unused]] static void simdARGB (juce::Image& img, size_t radius)
+    {
+        simdARGB (img, img, radius);
+    }
+}
@@ -0,0 +1,397 @@
+// No #pragma once on purpose!
+// simd_stack_blur.h includes this file once per instruction set,
+// each time inside a namespace that defines `ISA` and a matching target region.
+// That way every function touching vector registers is compiled for its instruction set
+// (a generic template would be compiled without AVX and change the vector ABI).
+
+// One stack blur pass over `length` lines, each line holding `numLanes` independent pixels
+// This is the vertical pass: the lines are image rows, progressing downwards
+// The queue keeps the original uint8 values (a quarter of the memory), they're converted as they're added
+inline void floatStackBlurPass (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, size_t radius, uint8_t* queue, float* stackSum, float* sumIn, float* sumOut)
+{
+    const auto queueSize = radius * 2 + 1;
+    const auto divisor = 1.0f / float ((radius + 1) * (radius + 1));
+    const auto lastLine = length - 1;
+
+    // prefill the left half and middle of the queue with the first line
+    {
+        auto first = data;
+        for (size_t q = 0; q <= radius; ++q)
+            memcpy (queue + q * numLanes, first, numLanes);
+
+        for (size_t i = 0; i < numLanes; ++i)
+        {
+            auto value = (float) first[i];
+            sumIn[i] = 0.0f;
+            sumOut[i] = value * float (radius + 1);
+            stackSum[i] = value * float ((radius + 1) * (radius + 2) / 2);
+        }
+    }
+
+    // the right half of the queue gets the next lines (or the last line, if the image is small)
+    for (size_t q = 1; q <= radius; ++q)
+    {
+        auto line = data + std::min (q, lastLine) * lineStride;
+        memcpy (queue + (radius + q) * numLanes, line, numLanes);
+        for (size_t i = 0; i < numLanes; ++i)
+        {
+            auto value = (float) line[i];
+            sumIn[i] += value;
+            stackSum[i] += value * float (radius + 1 - q);
+        }
+    }
+
+    const auto vectorDivisor = ISA::set (divisor);
+    size_t queueIndex = 0;
+
+    for (size_t x = 0; x < length; ++x)
+    {
+        // at the end of the image, the incoming line might be the one we're writing
+        // that's fine, it won't be output again
+        auto in = data + std::min (x + radius + 1, lastLine) * lineStride;
+        auto out = data + x * lineStride;
+
+        auto nextQueueIndex = queueIndex + 1 == queueSize ? 0 : queueIndex + 1;
+        auto middleIndex = (nextQueueIndex + radius) % queueSize;
+        auto oldest = queue + queueIndex * numLanes;
+        auto middle = queue + middleIndex * numLanes;
+
+        size_t i = 0;
+        for (; i + ISA::lanes <= numLanes; i += ISA::lanes)
+        {
+            auto sum = ISA::load (stackSum + i);
+            ISA::storeBytes (out + i, ISA::mul (sum, vectorDivisor));
+
+            auto outgoingSum = ISA::load (sumOut + i);
+            sum = ISA::sub (sum, outgoingSum);
+            outgoingSum = ISA::sub (outgoingSum, ISA::loadBytes (oldest + i));
+
+            // the oldest queue slot becomes the newest
+            memcpy (oldest + i, in + i, ISA::lanes);
+            auto incoming = ISA::loadBytes (in + i);
+
+            auto incomingSum = ISA::add (ISA::load (sumIn + i), incoming);
+            sum = ISA::add (sum, incomingSum);
+
+            // the new center pixel moves from the incoming to the outgoing side
+            auto center = ISA::loadBytes (middle + i);
+            ISA::store (sumOut + i, ISA::add (outgoingSum, center));
+            ISA::store (sumIn + i, ISA::sub (incomingSum, center));
+            ISA::store (stackSum + i, sum);
+        }
+
+        // leftover lanes
+        for (; i < numLanes; ++i)
+        {
+            out[i] = (uint8_t) (stackSum[i] * divisor);
+            stackSum[i] -= sumOut[i];
+            sumOut[i] -= (float) oldest[i];
+            oldest[i] = in[i];
+            sumIn[i] += (float) oldest[i];
+            stackSum[i] += sumIn[i];
+            sumOut[i] += (float) middle[i];
+            sumIn[i] -= (float) middle[i];
+        }
+
+        queueIndex = nextQueueIndex;
+    }
+}
+
+// Runs the pass on cache-sized strips of columns, so the queue and sums stay in L2
+// Strips are independent, so each one gets its own buffers and they can run in parallel
+inline void floatStripedPass (uint8_t* data, size_t lineStride, size_t w, size_t h, size_t radius, size_t numTasks)
+{
+    forEachStrip (w, radius * 2 + 1 + 3 * sizeof (float), numTasks, [&] (size_t x, size_t columns) {
+        // all queue lines live in one contiguous block
+        ScratchFrame scratch;
+        auto queue = scratch.allocate<uint8_t> ((radius * 2 + 1) * columns);
+        auto stackSum = scratch.allocate<float> (columns);
+        auto sumIn = scratch.allocate<float> (columns);
+        auto sumOut = scratch.allocate<float> (columns);
+        floatStackBlurPass (data + x, lineStride, columns, h, radius, queue, stackSum, sumIn, sumOut);
+    });
+}
+
+static void floatSingleChannel (uint8_t* data, size_t w, size_t h, size_t lineStride, size_t radius)
+{
+    const auto numTasks = parallelTasksFor (w * h);
+    ScratchFrame scratch;
+    auto transposed = scratch.allocate<uint8_t> (w * h);
+
+    // HORIZONTAL PASS: rows become columns, so the vertical pass can do them all at once
+    transpose<uint8_t> (data, lineStride, transposed, h, w, h, numTasks);
+    floatStripedPass (transposed, h, h, w, radius, numTasks);
+    transpose<uint8_t> (transposed, h, data, lineStride, h, w, numTasks);
+
+    // VERTICAL PASS: the lanes are the columns, progressing downwards
+    floatStripedPass (data, lineStride, w, h, radius, numTasks);
+}
+
+// Same pass as above, but in fixed point, so the output matches ginSingleChannel byte for byte
+// The queue stays uint8, sumIn/sumOut fit in uint16 (255 * 255) and the stack sum in uint32
+inline void integerStackBlurPass (uint8_t* data, size_t lineStride, size_t numLanes, size_t length, size_t radius, uint8_t* queue, uint32_t* stackSum, uint16_t* sumIn, uint16_t* sumOut)
+{
+    const auto queueSize = radius * 2 + 1;
+    const uint32_t mul = stackBlur::stackblur_mul[radius];
+    const uint32_t shr = stackBlur::stackblur_shr[radius];
+    const auto lastLine = length - 1;
+
+    // prefill the left half and middle of the queue with the first line
+    {
+        auto first = data;
+        for (size_t q = 0; q <= radius; ++q)
+            memcpy (queue + q * numLanes, first, numLanes);
+
+        for (size_t i = 0; i < numLanes; ++i)
+        {
+            sumIn[i] = 0;
+            sumOut[i] = (uint16_t) (first[i] * (radius + 1));
+            stackSum[i] = (uint32_t) (first[i] * ((radius + 1) * (radius + 2) / 2));
+        }
+    }
+
+    // the right half of the queue gets the next lines (or the last line, if the image is small)
+    for (size_t q = 1; q <= radius; ++q)
+    {
+        auto line = data + std::min (q, lastLine) * lineStride;
+        memcpy (queue + (radius + q) * numLanes, line, numLanes);
+
+        for (size_t i = 0; i < numLanes; ++i)
+        {
+            sumIn[i] = (uint16_t) (sumIn[i] + line[i]);
+            stackSum[i] += (uint32_t) (line[i] * (radius + 1 - q));
+        }
+    }
+
+    size_t queueIndex = 0;
+
+    for (size_t x = 0; x < length; ++x)
+    {
+        // at the end of the image, the incoming line might be the one we're writing
+        // that's fine, it won't be output again
+        auto in = data + std::min (x + radius + 1, lastLine) * lineStride;
+        auto out = data + x * lineStride;
+
+        auto nextQueueIndex = queueIndex + 1 == queueSize ? 0 : queueIndex + 1;
+        auto middleIndex = (nextQueueIndex + radius) % queueSize;
+        auto oldest = queue + queueIndex * numLanes;
+        auto middle = queue + middleIndex * numLanes;
+
+        size_t i = 0;
+        for (; i + ISA::intLanes <= numLanes; i += ISA::intLanes)
+        {
+            auto sum = ISA::loadSums (stackSum + i);
+            ISA::storeAverage (out + i, sum, mul, shr);
+
+            auto outgoingSum = ISA::loadWords (sumOut + i);
+            sum = ISA::subSums (sum, outgoingSum);
+            outgoingSum = ISA::subWords (outgoingSum, ISA::loadBytesAsWords (oldest + i));
+
+            // the oldest queue slot becomes the newest
+            auto incoming = ISA::loadBytesAsWords (in + i);
+            memcpy (oldest + i, in + i, ISA::intLanes);
+
+            auto incomingSum = ISA::addWords (ISA::loadWords (sumIn + i), incoming);
+            sum = ISA::addSums (sum, incomingSum);
+
+            // the new center pixel moves from the incoming to the outgoing side
+            auto center = ISA::loadBytesAsWords (middle + i);
+            ISA::storeWords (sumOut + i, ISA::addWords (outgoingSum, center));
+            ISA::storeWords (sumIn + i, ISA::subWords (incomingSum, center));
+            ISA::storeSums (stackSum + i, sum);
+        }
+
+        // leftover lanes
+        for (; i < numLanes; ++i)
+        {
+            out[i] = (uint8_t) ((stackSum[i] * mul) >> shr);
+            stackSum[i] -= sumOut[i];
+            sumOut[i] = (uint16_t) (sumOut[i] - oldest[i]);
+            oldest[i] = in[i];
+            sumIn[i] = (uint16_t) (sumIn[i] + oldest[i]);
+            stackSum[i] += sumIn[i];
+            sumOut[i] = (uint16_t) (sumOut[i] + middle[i]);
+            sumIn[i] = (uint16_t) (sumIn[i] - middle[i]);
+        }
+
+        queueIndex = nextQueueIndex;
+    }
+}
+
+// The same fixed point pass, with the radius known at compile time
+// It walks down `groups` registers' worth of lanes at a time, so the sums stay in registers the whole way
+// and the queue is a small local array (2 * R + 1 lines) with constant bounds
+// Two independent groups per walk keep the CPU busy while each one waits on its own sums
+// Returns how many lanes it did, the rest don't fill a group
+template <size_t R, size_t groups>
+inline size_t smallRadiusStackBlurColumns (uint8_t* data, size_t lineStride, size_t numLanes, size_t length)
+{
+    constexpr auto queueSize = R * 2 + 1;
+    constexpr auto laneBytes = ISA::intLanes * groups;
+    const uint32_t mul = stackBlur::stackblur_mul[R];
+    const uint32_t shr = stackBlur::stackblur_shr[R];
+    const auto lastLine = length - 1;
+
+    size_t i = 0;
+    for (; i + laneBytes <= numLanes; i += laneBytes)
+    {
+        uint8_t queue[queueSize][laneBytes];
+        auto column = data + i;
+
+        typename ISA::Sums sum[groups];
+        typename ISA::Words sumIn[groups], sumOut[groups];
+        for (size_t g = 0; g < groups; ++g)
+        {
+            sum[g] = ISA::zeroSums();
+            sumIn[g] = ISA::zeroWords();
+            sumOut[g] = ISA::zeroWords();
+        }
+
+        // prefill the left half and middle of the queue with the first line
+        // each step adds the sumOut so far, so the first line ends up weighted 1 + 2 + ... + (R + 1)
+        for (size_t q = 0; q <= R; ++q)
+        {
+            memcpy (queue[q], column, laneBytes);
+            for (size_t g = 0; g < groups; ++g)
+            {
+                sumOut[g] = ISA::addWords (sumOut[g], ISA::loadBytesAsWords (column + g * ISA::intLanes));
+                sum[g] = ISA::addSums (sum[g], sumOut[g]);
+            }
+        }
+
+        // the right half of the queue gets the next lines (or the last line, if the image is small)
+        // same trick: line q gets added R + 1 - q times
+        for (size_t q = 1; q <= R; ++q)
+        {
+            auto line = column + std::min (q, lastLine) * lineStride;
+            memcpy (queue[R + q], line, laneBytes);
+            for (size_t g = 0; g < groups; ++g)
+            {
+                sumIn[g] = ISA::addWords (sumIn[g], ISA::loadBytesAsWords (line + g * ISA::intLanes));
+                sum[g] = ISA::addSums (sum[g], sumIn[g]);
+            }
+        }
+
+        size_t oldest = 0;
+        size_t middle = R + 1;
+        for (size_t x = 0; x < length; ++x)
+        {
+            auto in = column + std::min (x + R + 1, lastLine) * lineStride;
+            auto out = column + x * lineStride;
+
+            for (size_t g = 0; g < groups; ++g)
+            {
+                const auto offset = g * ISA::intLanes;
+                ISA::storeAverage (out + offset, sum[g], mul, shr);
+
+                sum[g] = ISA::subSums (sum[g], sumOut[g]);
+                sumOut[g] = ISA::subWords (sumOut[g], ISA::loadBytesAsWords (queue[oldest] + offset));
+
+                // the oldest queue slot becomes the newest
+                sumIn[g] = ISA::addWords (sumIn[g], ISA::loadBytesAsWords (in + offset));
+                sum[g] = ISA::addSums (sum[g], sumIn[g]);
+
+                // the new center pixel moves from the incoming to the outgoing side
+                auto center = ISA::loadBytesAsWords (queue[middle] + offset);
+                sumOut[g] = ISA::addWords (sumOut[g], center);
+                sumIn[g] = ISA::subWords (sumIn[g], center);
+            }
+            memcpy (queue[oldest], in, laneBytes);
+
+            oldest = oldest + 1 == queueSize ? 0 : oldest + 1;
+            middle = middle + 1 == queueSize ? 0 : middle + 1;
+        }
+    }
+
+    return i;
+}
+
+template <size_t R>
+inline void smallRadiusStackBlurPass (uint8_t* data, size_t lineStride, size_t numLanes, size_t length)
+{
+    auto i = smallRadiusStackBlurColumns<R, 2> (data, lineStride, numLanes, length);
+    i += smallRadiusStackBlurColumns<R, 1> (data + i, lineStride, numLanes - i, length);
+
+    // leftover lanes: less than a register's worth, scalar code would take longer than all the rest
+    // so they're copied into a register wide column, blurred like the others and copied back
+    if (i < numLanes)
+    {
+        // (plain loops, a memcpy call per line costs more than the copy)
+        const auto leftover = numLanes - i;
+        ScratchFrame scratch;
+        auto column = scratch.allocateZeroed<uint8_t> (length * ISA::intLanes);
+        for (size_t x = 0; x < length; ++x)
+            for (size_t lane = 0; lane < leftover; ++lane)
+                column[x * ISA::intLanes + lane] = data[x * lineStride + i + lane];
+
+        smallRadiusStackBlurColumns<R, 1> (column, ISA::intLanes, ISA::intLanes, length);
+
+        for (size_t x = 0; x < length; ++x)
+            for (size_t lane = 0; lane < leftover; ++lane)
+                data[x * lineStride + i + lane] = column[x * ISA::intLanes + lane];
+    }
+}
+
+// Every small radius gets its own pass, looked up by radius - 1
+using SmallRadiusPass = void (*) (uint8_t*, size_t, size_t, size_t);
+
+template <size_t... Indices>
+constexpr std::array<SmallRadiusPass, sizeof...(Indices)> makeSmallRadiusPasses (std::index_sequence<Indices...>)
+{
+    return { &smallRadiusStackBlurPass<Indices + 1>... };
+}
+
+static constexpr auto smallRadiusPasses = makeSmallRadiusPasses (std::make_index_sequence<maxSmallRadius>());
+
+inline void integerStripedPass (uint8_t* data, size_t lineStride, size_t w, size_t h, size_t radius, size_t numTasks)
+{
+    if (radius <= maxSmallRadius)
+    {
+        // no per column buffers, strips are only needed to split the work across threads
+        forEachStrip (w, radius * 2 + 1, numTasks, [&] (size_t x, size_t columns) {
+            smallRadiusPasses[radius - 1] (data + x, lineStride, columns, h);
+        });
+        return;
+    }
+
+    forEachStrip (w, radius * 2 + 1 + sizeof (uint32_t) + 2 * sizeof (uint16_t), numTasks, [&] (size_t x, size_t columns) {
+        ScratchFrame scratch;
+        auto queue = scratch.allocate<uint8_t> ((radius * 2 + 1) * columns);
+        auto stackSum = scratch.allocate<uint32_t> (columns);
+        auto sumIn = scratch.allocate<uint16_t> (columns);
+        auto sumOut = scratch.allocate<uint16_t> (columns);
+        integerStackBlurPass (data + x, lineStride, columns, h, radius, queue, stackSum, sumIn, sumOut);
+    });
+}
+
+// Every byte is its own lane, so ARGB goes through the same pass as single channel:
+// the four channels of a row sit side by side, already planar as far as the vector registers care
+// Only the transpose needs to know about pixels (it moves all 4 channels together)
+// The first transpose reads from src and the second one writes to dst, so the blur can be out of place for free
+template <typename Pixel>
+static void integerStackBlur (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t w, size_t h, size_t radius)
+{
+    const auto numTasks = parallelTasksFor (w * h);
+    const auto columnBytes = h * sizeof (Pixel);
+    ScratchFrame scratch;
+    auto transposed = scratch.allocate<uint8_t> (columnBytes * w);
+
+    // HORIZONTAL PASS: rows become columns, so the vertical pass can do them all at once
+    transpose<Pixel> (src, srcLineStride, transposed, columnBytes, w, h, numTasks);
+    integerStripedPass (transposed, columnBytes, columnBytes, w, radius, numTasks);
+    transpose<Pixel> (transposed, columnBytes, dst, dstLineStride, h, w, numTasks);
+
+    // VERTICAL PASS: the lanes are the columns (times channels), progressing downwards
+    integerStripedPass (dst, dstLineStride, w * sizeof (Pixel), h, radius, numTasks);
+}
+
+static void integerSingleChannel (uint8_t* data, size_t w, size_t h, size_t lineStride, size_t radius)
+{
+    integerStackBlur<uint8_t> (data, lineStride, data, lineStride, w, h, radius);
+}
+
+// src and dst can be the same
+static void integerARGB (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t w, size_t h, size_t radius)
+{
+    integerStackBlur<uint32_t> (src, srcLineStride, dst, dstLineStride, w, h, radius);
+}
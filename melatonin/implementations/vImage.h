@@ -1,10 +1,15 @@
 #pragma once
+#include "../internal/scratch.h"
+#include "../internal/source_and_destination.h"
 #include "Accelerate/Accelerate.h"
 #include "juce_gui_basics/juce_gui_basics.h"
 
 namespace melatonin::blur
 {
-    static inline std::vector<float> createFloatKernel (size_t radius)
+    // Manufacture the stack blur-esque kernel into radius * 2 + 1 floats
+    // For example, for radius of 2:
+    // 1/9 2/9 3/9 2/9 1/9
+    static inline void fillFloatKernel (float* kernel, size_t radius)
     {
         // The kernel size is always odd
         size_t kernelSize = radius * 2 + 1;
@@ -13,40 +18,56 @@ namespace melatonin::blur
         // If you are familiar with stack blur, it's the size of the stack
         auto divisor = float (radius + 1) * (float) (radius + 1);
 
-        std::vector<float> kernel (kernelSize);
-
-        // Manufacture the stack blur-esque kernel
-        // For example, for radius of 2:
-        // 1/9 2/9 3/9 2/9 1/9
         for (size_t i = 0; i < kernelSize; ++i)
         {
             auto distance = (size_t) std::abs ((int) i - (int) radius);
             kernel[i] = (float) (radius + 1 - distance) / divisor;
         }
+    }
 
+    static inline std::vector<float> createFloatKernel (size_t radius)
+    {
+        std::vector<float> kernel (radius * 2 + 1);
+        fillFloatKernel (kernel.data(), radius);
         return kernel;
     }
 
-    static inline void vImageSingleChannel (juce::Image& img, size_t radius)
+    // vImage's convolutions aren't happy operating in-place, unfortunately
+    // so blurring a view into itself reads from a copy in scratch memory (a new image every time would hit the allocator)
+    [[nodiscard]] static inline ImageView vImageSourceFor (const ImageView& src, const ImageView& dst, ScratchFrame& scratch)
     {
-        const auto w = (unsigned int) img.getWidth();
-        const auto h = (unsigned int) img.getHeight();
-        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        if (src != dst)
+            return src;
+
+        ImageView copy { scratch.allocate<uint8_t> (src.lineStride * src.height), src.width, src.height, src.lineStride, src.pixelStride };
+        for (size_t y = 0; y < src.height; ++y)
+            memcpy (copy.getLinePointer (y), src.getLinePointer (y), src.width * src.pixelStride);
+        return copy;
+    }
 
-        auto kernel = createFloatKernel (radius);
+    static inline void vImageSingleChannel (const ImageView& srcView, const ImageView& dstView, size_t radius)
+    {
+        jassert (srcView.pixelStride == 1);
 
-        // vdsp convolution isn't happy operating in-place, unfortunately
-        auto copy = img.createCopy();
-        juce::Image::BitmapData copyData (copy, juce::Image::BitmapData::readOnly);
-        vImage_Buffer src = { copyData.getLinePointer (0), h, w, (size_t) data.lineStride };
+        ScratchFrame scratch;
+        auto kernel = scratch.allocate<float> (radius * 2 + 1);
+        fillFloatKernel (kernel, radius);
 
-        vImage_Buffer dst = { data.getLinePointer (0), h, w, (size_t) data.lineStride };
+        const auto readFrom = vImageSourceFor (srcView, dstView, scratch);
+        vImage_Buffer src = { readFrom.data, readFrom.height, readFrom.width, readFrom.lineStride };
+        vImage_Buffer dst = { dstView.data, dstView.height, dstView.width, dstView.lineStride };
 
         JUCE_BEGIN_IGNORE_WARNINGS_GCC_LIKE ("-Wunguarded-availability-new")
-        vImageSepConvolve_Planar8 (&src, &dst, nullptr, 0, 0, kernel.data(), (unsigned int) kernel.size(), kernel.data(), (unsigned int) kernel.size(), 0, Pixel_16U(), kvImageEdgeExtend);
+        vImageSepConvolve_Planar8 (&src, &dst, nullptr, 0, 0, kernel, (unsigned int) (radius * 2 + 1), kernel, (unsigned int) (radius * 2 + 1), 0, Pixel_16U(), kvImageEdgeExtend);
         JUCE_END_IGNORE_WARNINGS_GCC_LIKE
     }
 
+    static inline void vImageSingleChannel (juce::Image& img, size_t radius)
+    {
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        vImageSingleChannel (viewOf (data), viewOf (data), radius);
+    }
+
     // currently unused, may be benchmarked vs. drawImageAt
     [[maybe_unused]] static juce::Image convertToARGB (juce::Image& src, juce::Colour color)
     {
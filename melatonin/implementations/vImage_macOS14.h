@@ -5,23 +5,29 @@
 
 namespace melatonin::blur
 {
-    static inline void vImageARGB (juce::Image& srcImage, juce::Image& dstImage, size_t radius)
+    static inline void vImageARGB (const ImageView& srcView, const ImageView& dstView, size_t radius)
     {
-        jassert (srcImage.getFormat() == juce::Image::PixelFormat::ARGB);
-
-        auto kernel = createFloatKernel (radius);
+        jassert (srcView.pixelStride == 4);
 
-        const auto w = (unsigned int) srcImage.getWidth();
-        const auto h = (unsigned int) srcImage.getHeight();
-        juce::Image::BitmapData srcData (srcImage, juce::Image::BitmapData::readWrite);
-        juce::Image::BitmapData dstData (dstImage, juce::Image::BitmapData::readWrite);
+        ScratchFrame scratch;
+        auto kernel = scratch.allocate<float> (radius * 2 + 1);
+        fillFloatKernel (kernel, radius);
 
         // vImageSepConvolve isn't happy operating in-place
-        vImage_Buffer src = { srcData.getLinePointer (0), h, w, (size_t) srcData.lineStride };
-        vImage_Buffer dst = { dstData.getLinePointer (0), h, w, (size_t) dstData.lineStride };
-        
+        const auto readFrom = vImageSourceFor (srcView, dstView, scratch);
+        vImage_Buffer src = { readFrom.data, readFrom.height, readFrom.width, readFrom.lineStride };
+        vImage_Buffer dst = { dstView.data, dstView.height, dstView.width, dstView.lineStride };
+
         JUCE_BEGIN_IGNORE_WARNINGS_GCC_LIKE ("-Wunguarded-availability-new")
-        vImageSepConvolve_ARGB8888 (&src, &dst, nullptr, 0, 0, kernel.data(), (unsigned int) kernel.size(), kernel.data(), (unsigned int) kernel.size(), 0, Pixel_8888 { 0, 0, 0, 0 }, kvImageEdgeExtend);
+        vImageSepConvolve_ARGB8888 (&src, &dst, nullptr, 0, 0, kernel, (unsigned int) (radius * 2 + 1), kernel, (unsigned int) (radius * 2 + 1), 0, Pixel_8888 { 0, 0, 0, 0 }, kvImageEdgeExtend);
         JUCE_END_IGNORE_WARNINGS_GCC_LIKE
     }
+
+    static inline void vImageARGB (const juce::Image& srcImage, juce::Image& dstImage, size_t radius)
+    {
+        jassert (srcImage.getFormat() == juce::Image::PixelFormat::ARGB);
+
+        MappedImages images (srcImage, dstImage);
+        vImageARGB (images.source(), images.destination(), radius);
+    }
 }
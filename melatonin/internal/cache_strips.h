@@ -0,0 +1,53 @@
+#pragma once
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace melatonin::blur
+{
+    /*
+     * The vertical pass keeps 2 * radius + 1 queue rows (plus the sums) for every column.
+     * On wide images with big radii, that's hundreds of KB touched on every row step,
+     * which falls out of L2 and takes throughput with it.
+     *
+     * Columns are independent, so we can instead blur the image in vertical strips,
+     * each narrow enough that its queue and sums stay in cache all the way down.
+     */
+
+    // Conservative: most desktop CPUs have 256KB-2MB of L2 per core
+    static constexpr size_t stripCacheBudget = 256 * 1024;
+
+    // Strips are a multiple of this many columns, so rows are read in whole cache lines
+    static constexpr size_t stripAlignment = 64;
+
+    // bytesPerColumn is everything the pass keeps per column (queue, sums, etc)
+    [[nodiscard]] static inline size_t stripWidth (size_t bytesPerColumn, size_t width)
+    {
+        auto columns = stripCacheBudget / std::max (bytesPerColumn, (size_t) 1);
+        columns = std::max (stripAlignment, columns / stripAlignment * stripAlignment);
+        return std::min (columns, width);
+    }
+
+    // Calls fn (firstColumn, numColumns) for each strip
+    // With numTasks > 1, strips are also kept narrow enough that every task gets one, and run in parallel
+    template <typename Function>
+    static void forEachStrip (size_t width, size_t bytesPerColumn, size_t numTasks, Function&& fn)
+    {
+        // empty images (say, an inner shadow spread past its path) have no strips
+        if (width == 0)
+            return;
+
+        auto columnsPerStrip = stripWidth (bytesPerColumn, width);
+        if (numTasks > 1)
+        {
+            const auto columnsPerTask = (width + numTasks - 1) / numTasks;
+            columnsPerStrip = std::min (columnsPerStrip, std::max (stripAlignment, (columnsPerTask + stripAlignment - 1) / stripAlignment * stripAlignment));
+        }
+
+        const auto numStrips = (width + columnsPerStrip - 1) / columnsPerStrip;
+        runInParallel (numStrips, [&] (size_t strip) {
+            const auto x = strip * columnsPerStrip;
+            fn (x, std::min (columnsPerStrip, width - x));
+        });
+    }
+}
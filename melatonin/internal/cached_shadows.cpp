@@ -85,6 +85,27 @@ namespace melatonin::internal
         renderInternal (g);
     }
 
+    void CachedShadows::render (juce::Graphics& g, juce::Rectangle<float> area, const bool lowQuality)
+    {
+        renderRoundedRectangle (g, area, 0, lowQuality);
+    }
+
+    void CachedShadows::render (juce::Graphics& g, juce::Rectangle<int> area, const bool lowQuality)
+    {
+        renderRoundedRectangle (g, area.toFloat(), 0, lowQuality);
+    }
+
+    void CachedShadows::renderRoundedRectangle (juce::Graphics& g, juce::Rectangle<float> area, float cornerSize, const bool lowQuality)
+    {
+        juce::Path path;
+        if (cornerSize > 0)
+            path.addRoundedRectangle (area, cornerSize);
+        else
+            path.addRectangle (area);
+
+        render (g, path, lowQuality);
+    }
+
     void CachedShadows::render (juce::Graphics& g, const juce::String& text, const juce::Rectangle<float>& area, juce::Justification justification)
     {
         if (renderedSingleChannelShadows.empty())
@@ -228,10 +249,47 @@ namespace melatonin::internal
 
     void CachedShadows::recalculateBlurs()
     {
-        for (auto& shadow : renderedSingleChannelShadows)
+        auto& shadows = renderedSingleChannelShadows;
+        auto sameBlur = [] (const ShadowParametersInt& a, const ShadowParametersInt& b) {
+            return a.radius == b.radius && a.spread == b.spread && a.inner == b.inner;
+        };
+        auto sameMask = [] (const ShadowParametersInt& a, const ShadowParametersInt& b) {
+            // inner shadows fill around the path out to their radius
+            return a.spread == b.spread && a.inner == b.inner && (!a.inner || a.radius == b.radius);
+        };
+
+        // Shadows that only differ in color or offset blur the same, so each blur is only rendered once
+        std::vector<size_t> blurs;
+        for (size_t i = 0; i < shadows.size(); ++i)
         {
-            shadow.render (lastOriginAgnosticPath, scale, stroked);
+            auto isNew = std::none_of (blurs.begin(), blurs.end(), [&] (size_t blur) { return sameBlur (shadows[blur].parameters, shadows[i].parameters); });
+            if (isNew)
+                blurs.push_back (i);
         }
+
+        // and drop shadows with the same spread fill the same path, so that's only done once too
+        // the largest radius goes first, as its filled path has room for all the others
+        std::stable_sort (blurs.begin(), blurs.end(), [&] (size_t a, size_t b) { return shadows[a].parameters.radius > shadows[b].parameters.radius; });
+        std::vector<RenderedSingleChannelShadow::SharedMask> masks (blurs.size());
+
+        for (size_t i = 0; i < blurs.size(); ++i)
+        {
+            auto& shadow = shadows[blurs[i]];
+
+            // the first blur with this spread owns the mask, when there's another one to share it with
+            auto owner = (size_t) std::distance (blurs.begin(), std::find_if (blurs.begin(), blurs.end(), [&] (size_t blur) { return sameMask (shadows[blur].parameters, shadow.parameters); }));
+            auto numSharing = std::count_if (blurs.begin(), blurs.end(), [&] (size_t blur) { return sameMask (shadows[blur].parameters, shadow.parameters); });
+
+            shadow.render (lastOriginAgnosticPath, scale, stroked, numSharing > 1 ? &masks[owner] : nullptr);
+        }
+
+        for (size_t i = 0; i < shadows.size(); ++i)
+        {
+            auto blur = std::find_if (blurs.begin(), blurs.end(), [&] (size_t b) { return sameBlur (shadows[b].parameters, shadows[i].parameters); });
+            if (*blur != i)
+                shadows[i].renderLike (shadows[*blur], scale);
+        }
+
         needsRecalculate = false;
         needsRecomposite = true;
     }
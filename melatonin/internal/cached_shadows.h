@@ -1,5 +1,6 @@
 #pragma once
 #include "rendered_single_channel_shadow.h"
+#include <type_traits>
 
 namespace melatonin::internal
 {
@@ -33,6 +34,24 @@ namespace melatonin::internal
 
         void render (juce::Graphics& g, const juce::Path& newPath, bool lowQuality = false);
         void render (juce::Graphics& g, const juce::Path& newPath, const juce::PathStrokeType& newType, bool lowQuality = false);
+        // these just build the path for you, rectangles and rounded rectangles are recognized in any path
+        void render (juce::Graphics& g, juce::Rectangle<float> area, bool lowQuality = false);
+        void render (juce::Graphics& g, juce::Rectangle<int> area, bool lowQuality = false);
+
+        // rounded rectangles take any number for cornerSize, but not a bool
+        // otherwise render (g, area, true) would quietly be a corner size of 1
+        template <typename T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        void render (juce::Graphics& g, juce::Rectangle<float> area, T cornerSize, bool lowQuality = false)
+        {
+            renderRoundedRectangle (g, area, (float) cornerSize, lowQuality);
+        }
+
+        template <typename T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        void render (juce::Graphics& g, juce::Rectangle<int> area, T cornerSize, bool lowQuality = false)
+        {
+            renderRoundedRectangle (g, area.toFloat(), (float) cornerSize, lowQuality);
+        }
+
         void render (juce::Graphics& g, const juce::String& text, const juce::Rectangle<float>& area, juce::Justification justification);
         void render (juce::Graphics& g, const juce::String& text, const juce::Rectangle<int>& area, juce::Justification justification);
         void render (juce::Graphics& g, const juce::String& text, int x, int y, int width, int height, juce::Justification justification);
@@ -152,6 +171,7 @@ namespace melatonin::internal
         void updatePathIfNeeded (juce::Path& pathToBlur);
         void recalculateBlurs();
         void renderInternal (juce::Graphics& g);
+        void renderRoundedRectangle (juce::Graphics& g, juce::Rectangle<float> area, float cornerSize, bool lowQuality);
         void drawARGBComposite (juce::Graphics& g, bool optimizeClipBounds = false);
 
         // This is done at the main graphics context scale
@@ -0,0 +1,150 @@
+#pragma once
+#include "juce_graphics/juce_graphics.h"
+#include "parallel.h"
+#include "scratch.h"
+#include "source_and_destination.h"
+#include <array>
+
+/*
+ * The ARGB kernels blur all 4 channels of every pixel, but plenty of images don't need that.
+ * An opaque backdrop has 255 alpha everywhere (and a blur of 255s is 255s),
+ * and grayscale art has the same value in red, green and blue.
+ *
+ * Those images are split into planes, one per channel that's actually different,
+ * blurred with the single channel kernels and interleaved back together.
+ * An opaque image blurs 3 planes instead of 4 channels, an opaque grayscale one just 1.
+ */
+namespace melatonin::blur
+{
+    struct ARGBContent
+    {
+        bool opaque;
+        bool grayscale; // red, green and blue are the same in every pixel
+    };
+
+    // One pass over the pixels, which stops as soon as the image turns out to be neither
+    [[nodiscard]] static inline ARGBContent findARGBContent (const ImageView& img)
+    {
+        jassert (img.pixelStride == 4);
+
+        uint8_t alpha = 255;
+        uint8_t colourDifference = 0;
+        for (size_t y = 0; y < img.height; ++y)
+        {
+            const auto row = img.getLinePointer (y);
+
+            // branchless, so the compiler can vectorize it
+            for (size_t x = 0; x < img.width * 4; x += 4)
+            {
+                alpha &= row[x + juce::PixelARGB::indexA];
+                colourDifference |= (row[x + juce::PixelARGB::indexR] ^ row[x + juce::PixelARGB::indexG])
+                                    | (row[x + juce::PixelARGB::indexG] ^ row[x + juce::PixelARGB::indexB]);
+            }
+
+            if (alpha != 255 && colourDifference != 0)
+                return { false, false };
+        }
+
+        return { alpha == 255, colourDifference == 0 };
+    }
+
+    [[nodiscard]] static inline ARGBContent findARGBContent (const juce::Image& img)
+    {
+        jassert (img.getFormat() == juce::Image::ARGB);
+
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readOnly);
+        return findARGBContent (viewOf (data));
+    }
+
+    // Which plane each byte of an ARGB pixel comes from, -1 for an opaque alpha
+    struct ChannelPlanes
+    {
+        size_t numPlanes;
+        std::array<int, 4> planeForByte;
+
+        // the first byte of a pixel that comes from this plane
+        [[nodiscard]] size_t byteForPlane (size_t plane) const
+        {
+            size_t index = 0;
+            while (planeForByte[index] != (int) plane)
+                ++index;
+            return index;
+        }
+    };
+
+    // The fewest planes that hold all of an image's pixels
+    // Only worth it for opaque or grayscale images, anything else needs all 4
+    [[nodiscard]] static inline ChannelPlanes channelPlanesFor (ARGBContent content)
+    {
+        std::array<int, 4> planeForByte {};
+
+        const int numColourPlanes = content.grayscale ? 1 : 3;
+        planeForByte[juce::PixelARGB::indexR] = 0;
+        planeForByte[juce::PixelARGB::indexG] = content.grayscale ? 0 : 1;
+        planeForByte[juce::PixelARGB::indexB] = content.grayscale ? 0 : 2;
+        planeForByte[juce::PixelARGB::indexA] = content.opaque ? -1 : numColourPlanes;
+
+        return { (size_t) (content.opaque ? numColourPlanes : numColourPlanes + 1), planeForByte };
+    }
+
+    // A pixel at a time, every byte going to (or coming from) its own row
+    // Bytes that don't have a plane point at a scratch row, so the loops stay branchless and vectorize
+    static inline void deinterleaveRow (const uint8_t* src, std::array<uint8_t*, 4> rows, size_t width)
+    {
+        for (size_t x = 0; x < width; ++x)
+            for (size_t byte = 0; byte < 4; ++byte)
+                rows[byte][x] = src[x * 4 + byte];
+    }
+
+    static inline void interleaveRow (std::array<const uint8_t*, 4> rows, uint8_t* dst, size_t width)
+    {
+        for (size_t x = 0; x < width; ++x)
+            for (size_t byte = 0; byte < 4; ++byte)
+                dst[x * 4 + byte] = rows[byte][x];
+    }
+
+    // Copies the channels of src into single channel planes (of the same size)
+    static inline void splitIntoPlanes (const ImageView& src, const ChannelPlanes& layout, const ImageView* planes)
+    {
+        const auto width = src.width;
+
+        forEachBandInParallel (src.height, parallelTasksFor (width * src.height), 1, [&] (size_t y, size_t rows) {
+            ScratchFrame scratch;
+            const auto unused = scratch.allocate<uint8_t> (width);
+
+            for (auto line = y; line < y + rows; ++line)
+            {
+                // grayscale pixels go to the plane from the first of their colour bytes
+                std::array<uint8_t*, 4> planeRows { unused, unused, unused, unused };
+                for (size_t plane = 0; plane < layout.numPlanes; ++plane)
+                    planeRows[layout.byteForPlane (plane)] = planes[plane].getLinePointer (line);
+
+                deinterleaveRow (src.getLinePointer (line), planeRows, width);
+            }
+        });
+    }
+
+    // The other way around, filling in opaque alpha
+    static inline void mergePlanes (const ImageView* planes, const ChannelPlanes& layout, const ImageView& dst)
+    {
+        const auto width = dst.width;
+
+        forEachBandInParallel (dst.height, parallelTasksFor (width * dst.height), 1, [&] (size_t y, size_t rows) {
+            ScratchFrame scratch;
+            const auto opaque = scratch.allocate<uint8_t> (width);
+            std::fill_n (opaque, width, (uint8_t) 255);
+
+            for (auto line = y; line < y + rows; ++line)
+            {
+                std::array<const uint8_t*, 4> planeRows {};
+                for (size_t byte = 0; byte < 4; ++byte)
+                {
+                    const auto plane = layout.planeForByte[byte];
+                    planeRows[byte] = plane < 0 ? opaque : planes[(size_t) plane].getLinePointer (line);
+                }
+
+                interleaveRow (planeRows, dst.getLinePointer (line), width);
+            }
+        });
+    }
+}
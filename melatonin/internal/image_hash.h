@@ -0,0 +1,95 @@
+#pragma once
+#include "juce_graphics/juce_graphics.h"
+#include <cstdint>
+#include <cstring>
+
+/*
+ * A fast fingerprint of an image's pixels, so a cache can tell when they changed.
+ *
+ * It's xxHash64's core (https://github.com/Cyan4973/xxHash): 4 independent accumulators
+ * eating 32 bytes per round, which keeps the multipliers busy and runs at about memory speed.
+ * That's a fraction of the cost of the blur it saves.
+ *
+ * Rows are hashed one after the other, skipping the padding at the end of each line.
+ * Anything less than 32 bytes at the end of a row goes into a 5th accumulator,
+ * so this isn't byte-compatible with xxHash64, just as good at noticing changes.
+ */
+namespace melatonin::blur
+{
+    namespace hash
+    {
+        static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+        static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+        static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+        static inline uint64_t rotateLeft (uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        static inline uint64_t accumulate (uint64_t accumulator, uint64_t input)
+        {
+            return rotateLeft (accumulator + input * prime2, 31) * prime1;
+        }
+
+        static inline uint64_t merge (uint64_t result, uint64_t accumulator)
+        {
+            return (result ^ accumulate (0, accumulator)) * prime1 + prime4;
+        }
+
+        static inline uint64_t read64 (const uint8_t* p)
+        {
+            uint64_t value;
+            memcpy (&value, p, sizeof (value));
+            return value;
+        }
+    }
+
+    // Same pixels (and size and format) give the same hash
+    [[nodiscard]] static inline uint64_t hashImage (const juce::Image& img)
+    {
+        using namespace hash;
+
+        if (! img.isValid())
+            return 0;
+
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readOnly);
+        const auto rowBytes = (size_t) data.width * (size_t) data.pixelStride;
+
+        // the size and format are part of the seed, so a resize with the same bytes still counts as a change
+        const auto seed = ((uint64_t) data.width << 32) ^ ((uint64_t) data.height << 8) ^ (uint64_t) img.getFormat();
+        uint64_t lanes[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        uint64_t tail = seed + prime5;
+
+        for (int y = 0; y < data.height; ++y)
+        {
+            const auto row = data.getLinePointer (y);
+
+            size_t i = 0;
+            for (; i + 32 <= rowBytes; i += 32)
+                for (size_t lane = 0; lane < 4; ++lane)
+                    lanes[lane] = accumulate (lanes[lane], read64 (row + i + lane * 8));
+
+            for (; i + 8 <= rowBytes; i += 8)
+                tail = rotateLeft (tail ^ accumulate (0, read64 (row + i)), 27) * prime1 + prime4;
+
+            for (; i < rowBytes; ++i)
+                tail = rotateLeft (tail ^ ((uint64_t) row[i] * prime5), 11) * prime1;
+        }
+
+        auto result = rotateLeft (lanes[0], 1) + rotateLeft (lanes[1], 7) + rotateLeft (lanes[2], 12) + rotateLeft (lanes[3], 18);
+        for (auto lane : lanes)
+            result = merge (result, lane);
+        result ^= tail;
+
+        // avalanche, so every input bit affects every output bit
+        result ^= result >> 33;
+        result *= prime2;
+        result ^= result >> 29;
+        result *= prime3;
+        result ^= result >> 32;
+        return result;
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "juce_graphics/juce_graphics.h"
+#include "source_and_destination.h"
+#include <cstring>
+
+namespace melatonin::blur
+{
+    // Copies area of src into dst, with its top left corner at dstPosition (formats have to match)
+    static inline void copyPixels (const juce::Image& src, juce::Rectangle<int> area, juce::Image& dst, juce::Point<int> dstPosition)
+    {
+        jassert (src.getFormat() == dst.getFormat());
+        jassert (src.getBounds().contains (area) && dst.getBounds().contains (area.withPosition (dstPosition)));
+
+        if (area.isEmpty())
+            return;
+
+        juce::Image::BitmapData srcData (src, area.getX(), area.getY(), area.getWidth(), area.getHeight(), juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData dstData (dst, dstPosition.x, dstPosition.y, area.getWidth(), area.getHeight(), juce::Image::BitmapData::writeOnly);
+
+        const auto rowBytes = (size_t) (area.getWidth() * srcData.pixelStride);
+        for (int y = 0; y < area.getHeight(); ++y)
+            memcpy (dstData.getLinePointer (y), srcData.getLinePointer (y), rowBytes);
+    }
+
+    // The smallest rectangle holding every pixel that differs between two images of the same size and format
+    // Empty when they're identical
+    [[nodiscard]] static inline juce::Rectangle<int> findChangedArea (const juce::Image& before, const juce::Image& after)
+    {
+        jassert (before.getBounds() == after.getBounds() && before.getFormat() == after.getFormat());
+
+        juce::Image::BitmapData beforeData (before, juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData afterData (after, juce::Image::BitmapData::readOnly);
+        const auto pixelStride = (size_t) beforeData.pixelStride;
+        const auto rowBytes = (size_t) beforeData.width * pixelStride;
+
+        int top = -1, bottom = -1;
+        size_t left = rowBytes, right = 0;
+
+        for (int y = 0; y < beforeData.height; ++y)
+        {
+            auto a = beforeData.getLinePointer (y);
+            auto b = afterData.getLinePointer (y);
+
+            // most rows are untouched, memcmp gets through those fastest
+            if (memcmp (a, b, rowBytes) == 0)
+                continue;
+
+            if (top < 0)
+                top = y;
+            bottom = y;
+
+            // only the bytes outside the columns already known to have changed need a closer look
+            size_t first = 0;
+            while (first < left && a[first] == b[first])
+                ++first;
+            left = std::min (left, first);
+
+            size_t last = rowBytes;
+            while (last > right && a[last - 1] == b[last - 1])
+                --last;
+            right = std::max (right, last);
+        }
+
+        if (top < 0)
+            return {};
+
+        const auto firstColumn = (int) (left / pixelStride);
+        const auto endColumn = (int) ((right + pixelStride - 1) / pixelStride);
+        return { firstColumn, top, endColumn - firstColumn, bottom - top + 1 };
+    }
+
+    // The smallest rectangle holding every pixel that isn't all zeros
+    // For premultiplied ARGB that's every pixel that isn't fully transparent. Empty when none are
+    [[nodiscard]] static inline juce::Rectangle<int> findNonZeroBounds (const ImageView& img)
+    {
+        const auto pixelStride = img.pixelStride;
+        const auto width = img.width;
+
+        // ORs the bytes together 8 at a time, which the compiler turns into a vector loop
+        auto isZero = [] (const uint8_t* bytes, size_t numBytes) {
+            uint64_t any = 0;
+            size_t i = 0;
+            for (; i + 8 <= numBytes; i += 8)
+            {
+                uint64_t word;
+                memcpy (&word, bytes + i, sizeof (word));
+                any |= word;
+            }
+            for (; i < numBytes; ++i)
+                any |= bytes[i];
+            return any == 0;
+        };
+
+        auto rowIsZero = [&] (size_t y) { return isZero (img.getLinePointer (y), width * pixelStride); };
+
+        // a sprite on a big canvas: most of the time goes into skipping empty rows
+        size_t top = 0;
+        while (top < img.height && rowIsZero (top))
+            ++top;
+
+        if (top == img.height)
+            return {};
+
+        auto bottom = img.height - 1;
+        while (rowIsZero (bottom))
+            --bottom;
+
+        // each row only needs checking up to the columns already known to be in use
+        // so an opaque image is done after a single pixel on each side of each row
+        auto left = width, right = (size_t) 0;
+        for (auto y = top; y <= bottom; ++y)
+        {
+            auto row = img.getLinePointer (y);
+
+            size_t x = 0;
+            while (x < left && isZero (row + x * pixelStride, pixelStride))
+                ++x;
+            left = std::min (left, x);
+
+            x = width;
+            while (x > right && isZero (row + (x - 1) * pixelStride, pixelStride))
+                --x;
+            right = std::max (right, x);
+        }
+
+        return { (int) left, (int) top, (int) (right - left), (int) (bottom - top + 1) };
+    }
+
+    [[nodiscard]] static inline juce::Rectangle<int> findNonZeroBounds (const juce::Image& img)
+    {
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readOnly);
+        return findNonZeroBounds (viewOf (data));
+    }
+
+    // Zeros every pixel of img that isn't inside area
+    static inline void clearOutside (const ImageView& img, juce::Rectangle<int> area)
+    {
+        area = area.getIntersection ({ (int) img.width, (int) img.height });
+
+        const auto pixelStride = img.pixelStride;
+        const auto left = (size_t) area.getX();
+        const auto right = (size_t) area.getRight();
+
+        for (size_t y = 0; y < img.height; ++y)
+        {
+            auto row = img.getLinePointer (y);
+
+            if ((int) y < area.getY() || (int) y >= area.getBottom())
+            {
+                memset (row, 0, img.width * pixelStride);
+                continue;
+            }
+
+            memset (row, 0, left * pixelStride);
+            memset (row + right * pixelStride, 0, (img.width - right) * pixelStride);
+        }
+    }
+}
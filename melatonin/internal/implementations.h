@@ -2,6 +2,19 @@
 
 // ARGB on Windows and macOS fallback when no vImage
 #include "../implementations/gin.h"
+#include "channel_planes.h"
+#include "image_regions.h"
+#include "parallel.h"
+#include "source_and_destination.h"
+
+// Radii past gin's tables, on every platform
+#include "../implementations/large_radius.h"
+
+// The other kernels, on every platform
+#include "../blur_kernel.h"
+#include "../implementations/dual_filter.h"
+#include "../implementations/extended_box.h"
+#include "../implementations/recursive_gaussian.h"
 
 // These are *compile-time* flags for implementation choices
 // There are also runtime considerations
@@ -25,12 +38,21 @@
 #elif JUCE_WINDOWS
     #if defined(PAMPLEJUCE_IPP) || defined(JUCE_IPP_AVAILABLE)
         #define MELATONIN_BLUR_IPP 1
-        #include "../implementations/ipp_vector.h" // single channel
+        #include "../implementations/float_vector_stack_blur.h" // ImageViews
+        #include "../implementations/ipp_vector.h" // single channel juce::Images
     #else
         #include "../implementations/float_vector_stack_blur.h"
+        #if JUCE_INTEL
+            #define MELATONIN_BLUR_SIMD 1
+            #include "../implementations/simd_stack_blur.h" // single channel and ARGB
+        #endif
     #endif
 #elif JUCE_LINUX || JUCE_BSD || JUCE_ANDROID
     #include "../implementations/float_vector_stack_blur.h"
+    #if JUCE_INTEL
+        #define MELATONIN_BLUR_SIMD 1
+        #include "../implementations/simd_stack_blur.h" // single channel and ARGB
+    #endif
 #else
   #error "Unsupported platform!"
 #endif
@@ -70,31 +92,341 @@ namespace melatonin::internal
 }
 
 // Don't use these directly, use melatonin::CachedBlur!
+// (or the ImageView versions, to blur pixels that aren't in a juce::Image)
 namespace melatonin::blur
 {
-    [[maybe_unused]] static inline void singleChannel (juce::Image& img, size_t radius)
+    // gin's rows (and columns) are blurred independently of each other
+    // so big images are split into bands of them, one per thread
+    // gin only works in place, so each band of rows is copied over from src right before it's blurred
+    [[maybe_unused]] static inline void ginARGBInParallel (const ImageView& src, const ImageView& dst, size_t radius)
     {
+        SourceAndDestination images (src, dst);
+        const auto& data = images.destinationView();
+        const auto numTasks = parallelTasksFor (images.width() * images.height());
+        const auto clampedRadius = juce::jlimit (2u, 254u, static_cast<unsigned int> (radius));
+
+        forEachBandInParallel (data.height, numTasks, 1, [&] (size_t y, size_t rows) {
+            images.copyRows (y, rows);
+            stackBlur::ginARGBRows (data, clampedRadius, (unsigned int) y, (unsigned int) (y + rows));
+        });
+
+        // neighbouring bands share cache lines, so keep them a multiple of 16 pixels wide
+        forEachBandInParallel (data.width, numTasks, 16, [&] (size_t x, size_t columns) {
+            stackBlur::ginARGBColumns (data, clampedRadius, (unsigned int) x, (unsigned int) (x + columns));
+        });
+    }
+
+    // These run the regular blur on the bottom of the pyramid, see below
+    static inline void dualFilterSingleChannel (const ImageView& src, const ImageView& dst, size_t radius, size_t numLevels = 0);
+    static inline void dualFilterARGB (const ImageView& src, const ImageView& dst, size_t radius, size_t numLevels = 0);
+
+    /*
+     * The core API: blurs straight from one ImageView into another, without allocating or copying the image.
+     * dst has to be the same size and format as src. Passing the same view twice blurs in place,
+     * otherwise the two mustn't overlap.
+     */
+    [[maybe_unused]] static inline void singleChannel (const ImageView& src, const ImageView& dst, size_t radius, Kernel kernel = Kernel::stack)
+    {
+        jassert (src.pixelStride == 1);
+
+        // an image with no rows (or no columns) has nothing to blur, and the kernels all assume at least one
+        if (src.isEmpty())
+            return;
+
+        if (kernel == Kernel::gaussian)
+        {
+            extendedBoxSingleChannel (src, dst, radius);
+            return;
+        }
+
+        if (kernel == Kernel::recursiveGaussian)
+        {
+            recursiveGaussianSingleChannel (src, dst, radius);
+            return;
+        }
+
+        if (kernel == Kernel::dualFilter)
+        {
+            dualFilterSingleChannel (src, dst, radius);
+            return;
+        }
+
+        if (radius > maxStackBlurRadius)
+        {
+            largeRadiusSingleChannel (src, dst, radius);
+            return;
+        }
+
 #if MELATONIN_BLUR_VIMAGE
         if (internal::vImageSingleChannelAvailable())
-            melatonin::blur::vImageSingleChannel (img, radius);
+            melatonin::blur::vImageSingleChannel (src, dst, radius);
         else
-            melatonin::stackBlur::ginSingleChannel (img, static_cast<unsigned int> (radius));
-#elif defined(MELATONIN_BLUR_IPP)
-        ippVectorSingleChannel (img, radius);
+        {
+            // gin only blurs in place
+            SourceAndDestination (src, dst).copyRows (0, src.height);
+            melatonin::stackBlur::ginSingleChannel (dst, static_cast<unsigned int> (radius));
+        }
+#elif MELATONIN_BLUR_SIMD
+        // as does the SIMD kernel
+        SourceAndDestination (src, dst).copyRows (0, src.height);
+        simdSingleChannel (dst, radius);
 #else
-        melatonin::blur::juceFloatVectorSingleChannel (img, radius);
+        melatonin::blur::juceFloatVectorSingleChannel (src, dst, radius);
 #endif
     }
 
-    [[maybe_unused]] static inline void argb ([[maybe_unused]] juce::Image& srcImage, juce::Image& dstImage, size_t radius)
+    [[maybe_unused]] static inline void singleChannel (juce::Image& img, size_t radius, Kernel kernel = Kernel::stack)
     {
+        if (img.getBounds().isEmpty())
+            return;
+
+#if defined(MELATONIN_BLUR_IPP)
+        // IPP's stack blur only takes juce::Images
+        if (kernel == Kernel::stack && radius <= maxStackBlurRadius)
+        {
+            ippVectorSingleChannel (img, radius);
+            return;
+        }
+#endif
+
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        singleChannel (viewOf (data), viewOf (data), radius, kernel);
+    }
+
+    // Blurs every pixel of the image, see argb below
+    static inline void denseARGB (const ImageView& src, const ImageView& dst, size_t radius, Kernel kernel)
+    {
+        if (src.isEmpty())
+            return;
+
+        if (kernel == Kernel::gaussian)
+        {
+            extendedBoxARGB (src, dst, radius);
+            return;
+        }
+
+        if (kernel == Kernel::recursiveGaussian)
+        {
+            recursiveGaussianARGB (src, dst, radius);
+            return;
+        }
+
+        if (kernel == Kernel::dualFilter)
+        {
+            dualFilterARGB (src, dst, radius);
+            return;
+        }
+
+        if (radius > maxStackBlurRadius)
+        {
+            largeRadiusARGB (src, dst, radius);
+            return;
+        }
+
 #if MELATONIN_BLUR_VIMAGE_MACOS14
         if (internal::vImageARGBAvailable())
-            melatonin::blur::vImageARGB (srcImage, dstImage, radius);
+            melatonin::blur::vImageARGB (src, dst, radius);
         else
-            melatonin::stackBlur::ginARGB (dstImage, static_cast<unsigned int> (radius));
+            ginARGBInParallel (src, dst, radius);
+#elif MELATONIN_BLUR_SIMD
+        simdARGB (src, dst, radius);
 #else
-        stackBlur::ginARGB (dstImage, static_cast<unsigned int>(radius));
+        ginARGBInParallel (src, dst, radius);
 #endif
     }
+
+    static inline void denseARGB (const juce::Image& srcImage, juce::Image& dstImage, size_t radius, Kernel kernel)
+    {
+        MappedImages images (srcImage, dstImage);
+        denseARGB (images.source(), images.destination(), radius, kernel);
+    }
+
+    // The single channel version of the stack blur denseARGB picks, so a plane comes out exactly like that channel would
+    // (singleChannel can pick a different implementation, which rounds a little differently)
+    static inline void stackBlurPlane (const ImageView& img, size_t radius)
+    {
+        if (img.isEmpty())
+            return;
+
+        if (radius > maxStackBlurRadius)
+        {
+            largeRadiusSingleChannel (img, img, radius);
+            return;
+        }
+
+#if MELATONIN_BLUR_VIMAGE_MACOS14
+        if (internal::vImageARGBAvailable())
+            melatonin::blur::vImageSingleChannel (img, img, radius);
+        else
+            melatonin::stackBlur::ginSingleChannel (img, juce::jlimit (2u, 254u, static_cast<unsigned int> (radius)));
+#elif MELATONIN_BLUR_SIMD
+        simdSingleChannel (img, juce::jmax ((size_t) 2, radius));
+#else
+        melatonin::stackBlur::ginSingleChannel (img, juce::jlimit (2u, 254u, static_cast<unsigned int> (radius)));
+#endif
+    }
+
+    // Opaque and grayscale images are blurred one plane at a time, skipping the channels that don't need it
+    // The dual filter isn't, its pyramid's bottom blur rounds small radii differently for ARGB
+    static inline void fewestChannelsARGB (const ImageView& src, const ImageView& dst, size_t radius, Kernel kernel)
+    {
+        const auto content = kernel == Kernel::dualFilter ? ARGBContent {} : findARGBContent (src);
+        if (! content.opaque && ! content.grayscale)
+        {
+            denseARGB (src, dst, radius, kernel);
+            return;
+        }
+
+        // the planes live in scratch memory, so this doesn't allocate either
+        const auto layout = channelPlanesFor (content);
+        ScratchFrame scratch;
+        std::array<ImageView, 4> planes;
+        for (size_t plane = 0; plane < layout.numPlanes; ++plane)
+            planes[plane] = { scratch.allocate<uint8_t> (src.width * src.height), src.width, src.height, src.width, 1 };
+
+        splitIntoPlanes (src, layout, planes.data());
+        for (size_t plane = 0; plane < layout.numPlanes; ++plane)
+        {
+            if (kernel == Kernel::stack)
+                stackBlurPlane (planes[plane], radius);
+            else
+                singleChannel (planes[plane], planes[plane], radius, kernel);
+        }
+        mergePlanes (planes.data(), layout, dst);
+    }
+
+    // How far (in pixels) a non-transparent pixel can spread with this kernel
+    // 0 when there's no hard limit: the recursive Gaussian's tails never quite reach zero
+    // and the dual filter's pyramid depends on where the image's edges are
+    [[nodiscard]] static inline size_t blurReach (Kernel kernel, size_t radius)
+    {
+        if (kernel == Kernel::gaussian)
+            return extendedBoxGaussianReach (radius);
+
+        if (kernel == Kernel::stack)
+            return juce::jmax ((size_t) 2, radius); // gin never blurs with less than 2
+
+        return 0;
+    }
+
+    // Reads src and writes the blur to dst, see singleChannel for the rules
+    //
+    // Transparent pixels blur to transparent pixels, so when the kernel has a hard reach,
+    // only the non-transparent part of the image (plus that reach) is blurred
+    // An icon on a big transparent canvas then costs about as much as the icon
+    [[maybe_unused]] static inline void argb (const ImageView& src, const ImageView& dst, size_t radius, Kernel kernel = Kernel::stack)
+    {
+        jassert (src.pixelStride == 4);
+
+        if (src.isEmpty())
+            return;
+
+        const auto reach = blurReach (kernel, radius);
+        if (reach == 0)
+        {
+            fewestChannelsARGB (src, dst, radius, kernel);
+            return;
+        }
+
+        const juce::Rectangle<int> bounds { (int) src.width, (int) src.height };
+        const auto nonZero = findNonZeroBounds (src);
+        const auto area = nonZero.isEmpty() ? nonZero : nonZero.expanded ((int) reach).getIntersection (bounds);
+        if (area == bounds)
+        {
+            fewestChannelsARGB (src, dst, radius, kernel);
+            return;
+        }
+
+        // everything outside stays transparent (in place, it already is)
+        if (src != dst)
+            clearOutside (dst, area);
+
+        if (area.isEmpty())
+            return;
+
+        // the edges of the area are transparent, so blurring it on its own gives the same pixels
+        auto subView = [&] (const ImageView& view) { return view.getSubView ((size_t) area.getX(), (size_t) area.getY(), (size_t) area.getWidth(), (size_t) area.getHeight()); };
+        fewestChannelsARGB (subView (src), subView (dst), radius, kernel);
+    }
+
+    // Reads srcImage and writes the blur to dstImage, which has to be allocated already (same size and format)
+    // Passing the same image twice blurs in place
+    [[maybe_unused]] static inline void argb (const juce::Image& srcImage, juce::Image& dstImage, size_t radius, Kernel kernel = Kernel::stack)
+    {
+        MappedImages images (srcImage, dstImage);
+        argb (images.source(), images.destination(), radius, kernel);
+    }
+
+    // How far around a pixel the blur reads
+    // The recursive Gaussian and dual filter have no hard limit, 4 sigma out they're well under a rounding error
+    [[nodiscard]] static inline size_t blurHalo (Kernel kernel, size_t radius)
+    {
+        const auto reach = blurReach (kernel, radius);
+        return reach > 0 ? reach : 2 * radius;
+    }
+
+    // Blurs the srcArea part of srcImage into dstImage, which has to be srcArea's size already
+    // The pixels around srcArea (as far as the blur reads) come from srcImage, instead of repeating srcArea's edges,
+    // so the result lines up with the rest of the image: a glass panel over a window's snapshot has no seams
+    // Nothing is copied out of srcImage and nothing is allocated: the blur reads its pixels where they are, into scratch memory
+    [[maybe_unused]] static inline void argb (const juce::Image& srcImage, juce::Rectangle<int> srcArea, juce::Image& dstImage, size_t radius, Kernel kernel = Kernel::stack)
+    {
+        jassert (srcImage.getBounds().contains (srcArea));
+        jassert (dstImage.getBounds() == srcArea.withZeroOrigin());
+
+        const auto readArea = srcArea.expanded ((int) blurHalo (kernel, radius)).getIntersection (srcImage.getBounds());
+        if (readArea == srcArea)
+        {
+            argb (srcImage.getClippedImage (srcArea), dstImage, radius, kernel);
+            return;
+        }
+
+        // the pixels around srcArea blur too, into scratch memory, and only srcArea's rows are written to dstImage
+        juce::Image::BitmapData srcData (srcImage, readArea.getX(), readArea.getY(), readArea.getWidth(), readArea.getHeight(), juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData dstData (dstImage, juce::Image::BitmapData::writeOnly);
+        const auto source = viewOf (srcData);
+        const auto destination = viewOf (dstData);
+
+        ScratchFrame scratch;
+        const auto lineStride = source.width * source.pixelStride;
+        const ImageView blurred { scratch.allocate<uint8_t> (lineStride * source.height), source.width, source.height, lineStride, source.pixelStride };
+        argb (source, blurred, radius, kernel);
+
+        const auto offset = srcArea.getPosition() - readArea.getPosition();
+        const auto rowBytes = destination.width * destination.pixelStride;
+        for (size_t y = 0; y < destination.height; ++y)
+            memcpy (destination.getLinePointer (y), blurred.getPixelPointer ((size_t) offset.x, y + (size_t) offset.y), rowBytes);
+    }
+
+    // numLevels of 0 picks from the radius, more levels is faster and loses more detail
+    static inline void dualFilterSingleChannel (const ImageView& src, const ImageView& dst, size_t radius, size_t numLevels)
+    {
+        dualFilter<uint8_t> (src, dst, radius, numLevels, [] (const ImageView& bottom, size_t bottomRadius) {
+            singleChannel (bottom, bottom, bottomRadius);
+        });
+    }
+
+    static inline void dualFilterARGB (const ImageView& src, const ImageView& dst, size_t radius, size_t numLevels)
+    {
+        dualFilter<uint32_t> (src, dst, radius, numLevels, [] (const ImageView& bottom, size_t bottomRadius) {
+            argb (bottom, bottom, bottomRadius);
+        });
+    }
+
+    [[maybe_unused]] static inline void dualFilterSingleChannel (juce::Image& img, size_t radius, size_t numLevels = 0)
+    {
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        dualFilterSingleChannel (viewOf (data), viewOf (data), radius, numLevels);
+    }
+
+    [[maybe_unused]] static inline void dualFilterARGB (const juce::Image& srcImage, juce::Image& dstImage, size_t radius, size_t numLevels = 0)
+    {
+        MappedImages images (srcImage, dstImage);
+        dualFilterARGB (images.source(), images.destination(), radius, numLevels);
+    }
+
+    [[maybe_unused]] static inline void dualFilterARGB (juce::Image& img, size_t radius, size_t numLevels = 0)
+    {
+        dualFilterARGB (img, img, radius, numLevels);
+    }
 }
@@ -0,0 +1,42 @@
+#pragma once
+#include "../multithreading.h"
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+
+namespace melatonin::blur
+{
+    // How many tasks a blur over this many pixels should be split into
+    // 1 means stay on the calling thread (multithreading is off or the image is small)
+    [[nodiscard]] size_t parallelTasksFor (size_t numPixels);
+
+    // Calls task (context, 0) ... task (context, numTasks - 1) on the worker threads and the calling thread
+    // Returns once all of them are done
+    using ParallelTask = void (*) (void* context, size_t index);
+    void runInParallel (size_t numTasks, ParallelTask task, void* context);
+
+    // Same for any callable, without the heap allocation a std::function would need
+    template <typename Function>
+    static void runInParallel (size_t numTasks, Function&& task)
+    {
+        runInParallel (
+            numTasks,
+            [] (void* context, size_t index) { (*static_cast<std::remove_reference_t<Function>*> (context)) (index); },
+            const_cast<void*> (static_cast<const void*> (std::addressof (task))));
+    }
+
+    // Splits [0, size) into about numTasks bands, each a multiple of alignment (except the last)
+    // and calls fn (start, length) for every band in parallel
+    template <typename Function>
+    static void forEachBandInParallel (size_t size, size_t numTasks, size_t alignment, Function&& fn)
+    {
+        auto bandSize = (size + numTasks - 1) / std::max (numTasks, (size_t) 1);
+        bandSize = std::max (alignment, (bandSize + alignment - 1) / alignment * alignment);
+
+        const auto numBands = (size + bandSize - 1) / bandSize;
+        runInParallel (numBands, [&] (size_t band) {
+            const auto start = band * bandSize;
+            fn (start, std::min (bandSize, size - start));
+        });
+    }
+}
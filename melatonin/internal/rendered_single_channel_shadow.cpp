@@ -1,12 +1,14 @@
 #include "rendered_single_channel_shadow.h"
 #include "implementations.h"
+#include "rounded_rectangle_shadow.h"
+#include "symmetric_shadow.h"
 #include "juce_gui_basics/juce_gui_basics.h"
 
 namespace melatonin::internal
 {
     RenderedSingleChannelShadow::RenderedSingleChannelShadow (ShadowParametersInt p) : parameters (p) {}
 
-    juce::Image& RenderedSingleChannelShadow::render (juce::Path& originAgnosticPath, float scale, bool stroked)
+    juce::Image& RenderedSingleChannelShadow::render (juce::Path& originAgnosticPath, float scale, bool stroked, SharedMask* sharedMask)
     {
         jassert (scale > 0);
         scaledPathBounds = (originAgnosticPath.getBounds() * scale).getSmallestIntegerContainer();
@@ -16,6 +18,13 @@ namespace melatonin::internal
         if (parameters.radius < 1 || scaledShadowBounds.isEmpty())
             singleChannelRender = juce::Image();
 
+        // Rectangles and rounded rectangles (most of a UI's shadows) are calculated without filling or blurring them
+        // see rounded_rectangle_shadow.h
+        if (!stroked && scaledRadius > 0 && !scaledShadowBounds.isEmpty())
+            if (auto shape = melatonin::blur::findRoundedRectangle (originAgnosticPath))
+                if (renderRoundedRectangle (*shape, scale))
+                    return singleChannelRender;
+
         // We can't modify our original path as it would break cache.
         // Remember, the origin of the path will always be 0,0
         auto shadowPath = juce::Path (originAgnosticPath);
@@ -40,24 +49,12 @@ namespace melatonin::internal
         }
 
         // each shadow is its own single channel image associated with a color
-        juce::Image renderedSingleChannel (juce::Image::SingleChannel, scaledShadowBounds.getWidth(), scaledShadowBounds.getHeight(), true);
-        {
-            // boot up a graphics context to give us access to fillPath, etc
-            juce::Graphics g2 (renderedSingleChannel);
-
-            // ensure we're working at the correct scale
-            g2.addTransform (juce::AffineTransform::scale (scale));
-
-            // cache at full opacity (later composited with the correct color/opacity)
-            g2.setColour (juce::Colours::white);
+        auto renderedSingleChannel = fillMask (shadowPath, scale, sharedMask);
 
-            // we're still working @1x until fillPath happens
-            // blurContextBounds x/y is negative (relative to path @ 0,0) and we must render in positive space
-            // Note that offset isn't used here,
-            auto unscaledPosition = -scaledShadowBounds.getPosition().toFloat() / scale;
+        // Ellipses only blur part of the mask when its pixels say the rest are copies, see symmetric_shadow.h
+        if (!stroked && !renderedSingleChannel.getBounds().isEmpty() && melatonin::blur::isEllipse (originAgnosticPath) && renderMirrored (renderedSingleChannel))
+            return singleChannelRender;
 
-            g2.fillPath (shadowPath, juce::AffineTransform::translation (unscaledPosition));
-        }
         // perform the blur with the fastest algorithm available
         melatonin::blur::singleChannel (renderedSingleChannel, (size_t) scaledRadius);
 
@@ -65,6 +62,155 @@ namespace melatonin::internal
         return singleChannelRender;
     }
 
+    void RenderedSingleChannelShadow::renderLike (const RenderedSingleChannelShadow& other, float scale)
+    {
+        jassert (other.parameters.radius == parameters.radius && other.parameters.spread == parameters.spread && other.parameters.inner == parameters.inner);
+
+        scaledPathBounds = other.scaledPathBounds;
+        updateScaledShadowBounds (scale);
+        singleChannelRender = other.singleChannelRender;
+    }
+
+    // The shadow path filled in white, for the area of the shadow's image (relative to the scaled path)
+    juce::Image RenderedSingleChannelShadow::fillShadowPath (const juce::Path& shadowPath, juce::Rectangle<int> area, float scale)
+    {
+        juce::Image filled (juce::Image::SingleChannel, area.getWidth(), area.getHeight(), true);
+
+        // boot up a graphics context to give us access to fillPath, etc
+        juce::Graphics g2 (filled);
+
+        // ensure we're working at the correct scale
+        g2.addTransform (juce::AffineTransform::scale (scale));
+
+        // cache at full opacity (later composited with the correct color/opacity)
+        g2.setColour (juce::Colours::white);
+
+        // we're still working @1x until fillPath happens
+        // blurContextBounds x/y is negative (relative to path @ 0,0) and we must render in positive space
+        // Note that offset isn't used here,
+        auto unscaledPosition = -area.getPosition().toFloat() / scale;
+
+        g2.fillPath (shadowPath, juce::AffineTransform::translation (unscaledPosition));
+        return filled;
+    }
+
+    // The filled shadow path, ready to be blurred in place
+    juce::Image RenderedSingleChannelShadow::fillMask (const juce::Path& shadowPath, float scale, SharedMask* sharedMask)
+    {
+        if (sharedMask == nullptr || scaledShadowBounds.isEmpty())
+            return fillShadowPath (shadowPath, scaledShadowBounds, scale);
+
+        // the blur happens in place, so the shared mask is cropped into a copy
+        if (sharedMask->image.isNull() || !sharedMask->area.contains (scaledShadowBounds) || (parameters.inner && sharedMask->radius != scaledRadius))
+            *sharedMask = { fillShadowPath (shadowPath, scaledShadowBounds, scale), scaledShadowBounds, scaledRadius };
+
+        juce::Image mask (juce::Image::SingleChannel, scaledShadowBounds.getWidth(), scaledShadowBounds.getHeight(), false);
+        melatonin::blur::copyPixels (sharedMask->image, scaledShadowBounds - sharedMask->area.getPosition(), mask, {});
+        return mask;
+    }
+
+    // The filled shadow path of shape, in the shadow's image
+    melatonin::blur::RoundedRectangleMask RenderedSingleChannelShadow::maskFor (melatonin::blur::RoundedRectangle shape, float scale) const
+    {
+        if (parameters.spread != 0)
+        {
+            // like scaleToFit in render, the corners stretch along with the rest of the path
+            auto spreadArea = shape.area.expanded (parameters.inner ? (float) -parameters.spread : (float) parameters.spread);
+            if (shape.area.getWidth() > 0 && shape.area.getHeight() > 0)
+                shape.cornerSize = { shape.cornerSize.x * spreadArea.getWidth() / shape.area.getWidth(),
+                    shape.cornerSize.y * spreadArea.getHeight() / shape.area.getHeight() };
+            shape.area = spreadArea;
+        }
+
+        // into the image's pixels
+        const auto position = scaledShadowBounds.getPosition().toFloat();
+        melatonin::blur::RoundedRectangleMask mask { { shape.area * scale - position, shape.cornerSize * scale }, {}, { scaledShadowBounds.getWidth(), scaledShadowBounds.getHeight() } };
+
+        // the rectangle render adds around inner shadows' paths
+        if (parameters.inner)
+            mask.around = shape.area.expanded ((float) scaledRadius) * scale - position;
+
+        return mask;
+    }
+
+    // Calculates the shadow's nine patch and stretches it, see rounded_rectangle_shadow.h
+    bool RenderedSingleChannelShadow::renderRoundedRectangle (melatonin::blur::RoundedRectangle shape, float scale)
+    {
+        const auto mask = maskFor (shape, scale);
+
+        // spread can leave nothing of the shape, the path takes care of that
+        if (mask.shape.area.isEmpty())
+            return false;
+
+        const auto reach = melatonin::blur::blurReach (melatonin::blur::Kernel::stack, (size_t) scaledRadius);
+        const auto ninePatch = melatonin::blur::ninePatchFor (mask.shape, reach, mask.size);
+        const auto compact = melatonin::blur::compactMaskFor (mask, ninePatch);
+
+        // the same corners as last time (the middle only changed size) are the same shadow
+        auto& cached = cachedNinePatch;
+        if (cached.image.isNull() || cached.radius != scaledRadius || cached.mask != compact)
+        {
+            // rectangles on whole pixels are filled and blurred, to get the blur's pixels exactly
+            const auto aligned = melatonin::blur::isAlignedRectangle (compact);
+            juce::Image rendered (juce::Image::SingleChannel, compact.size.x, compact.size.y, false);
+            {
+                juce::Image::BitmapData data (rendered, juce::Image::BitmapData::writeOnly);
+                if (aligned)
+                    melatonin::blur::fillAlignedRectangle (compact, melatonin::blur::viewOf (data));
+                else
+                    melatonin::blur::renderRoundedRectangleShadow (compact, (size_t) scaledRadius, melatonin::blur::viewOf (data));
+            }
+
+            if (aligned)
+                melatonin::blur::singleChannel (rendered, (size_t) scaledRadius);
+
+            cached = { compact, rendered, scaledRadius };
+        }
+
+        // nothing to stretch, the image is only ever read from here on
+        if (!ninePatch.isStretched())
+        {
+            singleChannelRender = cached.image;
+            return true;
+        }
+
+        singleChannelRender = juce::Image (juce::Image::SingleChannel, mask.size.x, mask.size.y, false);
+        juce::Image::BitmapData ninePatchData (cached.image, juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData data (singleChannelRender, juce::Image::BitmapData::writeOnly);
+        melatonin::blur::stretchNinePatch (melatonin::blur::viewOf (ninePatchData), melatonin::blur::viewOf (data), ninePatch);
+        return true;
+    }
+
+    // Blurs the top left quarter of mask (in place) and mirrors it into the rest, when mask is mirrored both ways
+    bool RenderedSingleChannelShadow::renderMirrored (juce::Image& mask)
+    {
+        const auto imageSize = juce::Point<int> (mask.getWidth(), mask.getHeight());
+        const auto quarter = melatonin::blur::quarterSize (imageSize);
+        const auto reach = (int) melatonin::blur::blurReach (melatonin::blur::Kernel::stack, (size_t) scaledRadius);
+        const auto renderedSize = juce::Point<int> (std::min (imageSize.x, quarter.x + reach), std::min (imageSize.y, quarter.y + reach));
+        if (renderedSize == imageSize)
+            return false;
+
+        {
+            juce::Image::BitmapData data (mask, juce::Image::BitmapData::readOnly);
+            if (!melatonin::blur::isMirrored (melatonin::blur::viewOf (data)))
+                return false;
+        }
+
+        // the quarter's blur reads reach past it, which is all still there
+        auto rendered = mask.getClippedImage ({ renderedSize.x, renderedSize.y });
+        melatonin::blur::singleChannel (rendered, (size_t) scaledRadius);
+
+        {
+            juce::Image::BitmapData data (mask, juce::Image::BitmapData::readWrite);
+            const auto view = melatonin::blur::viewOf (data);
+            melatonin::blur::mirrorQuarter (view.getSubView (0, 0, (size_t) quarter.x, (size_t) quarter.y), view);
+        }
+
+        singleChannelRender = mask;
+        return true;
+    }
+
     // Offset is added on the fly, it's not actually a part of the render
     // and can change without invalidating cache
     juce::Rectangle<int> RenderedSingleChannelShadow::getScaledBounds()
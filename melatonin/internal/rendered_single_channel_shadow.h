@@ -1,5 +1,6 @@
 #pragma once
 #include "juce_gui_basics/juce_gui_basics.h"
+#include "rounded_rectangle_shadow.h"
 
 namespace melatonin
 {
@@ -61,7 +62,23 @@ namespace melatonin
 
             explicit RenderedSingleChannelShadow (ShadowParametersInt p);
 
-            juce::Image& render (juce::Path& originAgnosticPath, float scale, bool stroked = false);
+            // The filled path before it's blurred, which shadows with the same spread can share
+            // area is where the image is, relative to the (scaled) path
+            struct SharedMask
+            {
+                juce::Image image;
+                juce::Rectangle<int> area;
+
+                // inner shadows fill around the path out to their radius, so only that radius can share those
+                int radius = 0;
+            };
+
+            // Shadows that share a mask crop it instead of filling the path again
+            // it's filled by the first one that needs more of it, so start with the largest radius
+            juce::Image& render (juce::Path& originAgnosticPath, float scale, bool stroked = false, SharedMask* sharedMask = nullptr);
+
+            // Reuses the render of a shadow with the same radius, spread and inner-ness (the image is shared, not copied)
+            void renderLike (const RenderedSingleChannelShadow& other, float scale);
 
             // Offset is added on the fly, it's not actually a part of the render
             // and can change without invalidating cache
@@ -89,6 +106,23 @@ namespace melatonin
 
             // Offsets are separately stored to translate placement in ARGB compositing.
             juce::Point<int> scaledOffset;
+
+            // Rectangles and rounded rectangles keep their shadow's nine patch around
+            // resizing them only stretches it again, as long as the corners are the same
+            struct CachedNinePatch
+            {
+                melatonin::blur::RoundedRectangleMask mask;
+                juce::Image image;
+                int radius = 0;
+            };
+
+            CachedNinePatch cachedNinePatch;
+
+            juce::Image fillShadowPath (const juce::Path& shadowPath, juce::Rectangle<int> area, float scale);
+            juce::Image fillMask (const juce::Path& shadowPath, float scale, SharedMask* sharedMask);
+            [[nodiscard]] melatonin::blur::RoundedRectangleMask maskFor (melatonin::blur::RoundedRectangle shape, float scale) const;
+            bool renderRoundedRectangle (melatonin::blur::RoundedRectangle shape, float scale);
+            bool renderMirrored (juce::Image& mask);
         };
     }
 }
@@ -0,0 +1,489 @@
+#pragma once
+#include "../image_view.h"
+#include "juce_graphics/juce_graphics.h"
+#include "scratch.h"
+#include <array>
+#include <cstring>
+#include <optional>
+
+/*
+ * Shadows of rectangles and rounded rectangles, most of a UI's shadows.
+ *
+ * They're calculated directly, without filling the path or blurring anything.
+ * The stack blur weighs pixels with a triangle, and a triangle's sums have a closed form. A rectangle's
+ * blur is then the product of a blurred row and a blurred column, and the corners are what the outline
+ * JUCE fills (its flattened corner curves) cuts out of that rectangle, added up a pixel's piece at a time.
+ * So the work grows with the size of the image, not with the radius.
+ *
+ * That's the exact blur of the shape. Filling and blurring antialias it to 8 bits first,
+ * and round down after each direction, so the two are within 3 levels of each other (see maxRoundedRectangleError).
+ * Rectangles on whole pixels fill to nothing but 0s and 255s, so those are filled directly and blurred instead,
+ * and get exactly the regular blur's pixels.
+ *
+ * Far enough inside the shape (past its corners, and as far again as the blur reaches),
+ * every column of the shadow is the same, and so is every row. So only its corners plus one row and column
+ * through the middle (a nine patch) are calculated, and when just the middle changed size, nothing is.
+ */
+namespace melatonin::blur
+{
+    struct RoundedRectangle
+    {
+        juce::Rectangle<float> area;
+
+        // width and height of the corners' quarter ellipses
+        // (they're circles until spread stretches the rectangle more one way than the other)
+        juce::Point<float> cornerSize;
+    };
+
+    // A rounded rectangle shadow's filled path, in the pixels of the shadow's image
+    struct RoundedRectangleMask
+    {
+        RoundedRectangle shape;
+
+        // inner shadows fill everything around the shape instead, out to here (empty for drop shadows)
+        juce::Rectangle<float> around;
+
+        juce::Point<int> size;
+
+        [[nodiscard]] bool operator== (const RoundedRectangleMask& other) const
+        {
+            return shape.area == other.shape.area && shape.cornerSize == other.shape.cornerSize && around == other.around && size == other.size;
+        }
+
+        [[nodiscard]] bool operator!= (const RoundedRectangleMask& other) const { return !(*this == other); }
+    };
+
+    // How far the calculated shadow can be from filling the mask and blurring it, in levels of 255
+    static constexpr int maxRoundedRectangleError = 3;
+
+    /*
+     * A shadow's corners, plus a single row and column through its middle.
+     *
+     * The middle rows and columns are left out of the shadow, and put back by copying the one in front.
+     * So a shape that only changed size has the same nine patch, which doesn't need calculating again.
+     */
+    struct NinePatch
+    {
+        // the middle rows and columns left out went in front of these
+        juce::Point<int> stretchAt;
+        juce::Point<int> removed;
+
+        [[nodiscard]] bool isStretched() const { return !removed.isOrigin(); }
+    };
+
+    // Where the nine patch of shape's shadow would be, in an image of imageSize (shape in the image's pixels)
+    // reach is how far the blur reads
+    [[nodiscard]] static inline NinePatch ninePatchFor (const RoundedRectangle& shape, size_t reach, juce::Point<int> imageSize)
+    {
+        // only shapes inside the image, so what's past the image's edges is the same as before
+        if (! juce::Rectangle<int> (imageSize.x, imageSize.y).toFloat().contains (shape.area))
+            return {};
+
+        // (a couple of pixels spare, for antialiased edges)
+        auto ninePatchAlong = [&] (float start, float end, float cornerSize, int& stretchAt, int& removed) {
+            const auto numToKeep = (int) std::ceil (cornerSize) + (int) reach + 3;
+            const auto first = (int) std::floor (start);
+            stretchAt = first + numToKeep;
+            removed = std::max (0, (int) std::ceil (end) - first - 2 * numToKeep);
+        };
+
+        NinePatch ninePatch;
+        ninePatchAlong (shape.area.getX(), shape.area.getRight(), shape.cornerSize.x, ninePatch.stretchAt.x, ninePatch.removed.x);
+        ninePatchAlong (shape.area.getY(), shape.area.getBottom(), shape.cornerSize.y, ninePatch.stretchAt.y, ninePatch.removed.y);
+        return ninePatch;
+    }
+
+    // The mask of a nine patch's corners: the same shape, without the middle rows and columns
+    [[nodiscard]] static inline RoundedRectangleMask compactMaskFor (RoundedRectangleMask mask, const NinePatch& ninePatch)
+    {
+        const auto removed = ninePatch.removed.toFloat();
+        auto compacted = [&] (juce::Rectangle<float> area) { return area.withSize (area.getWidth() - removed.x, area.getHeight() - removed.y); };
+
+        mask.shape.area = compacted (mask.shape.area);
+        if (!mask.around.isEmpty())
+            mask.around = compacted (mask.around);
+        mask.size -= ninePatch.removed;
+        return mask;
+    }
+
+    // Copies a rendered nine patch into dst, putting its middle back in
+    static inline void stretchNinePatch (const ImageView& compact, const ImageView& dst, const NinePatch& ninePatch)
+    {
+        jassert (compact.pixelStride == 1 && dst.pixelStride == 1);
+        const auto removed = ninePatch.removed;
+        jassert (compact.width + (size_t) removed.x == dst.width && compact.height + (size_t) removed.y == dst.height);
+
+        // with nothing removed there's nothing to stretch
+        const auto column = removed.x > 0 ? (size_t) ninePatch.stretchAt.x : compact.width;
+        const auto row = removed.y > 0 ? (size_t) ninePatch.stretchAt.y : compact.height;
+        jassert (column > 0 && column <= compact.width && row > 0 && row <= compact.height);
+
+        for (size_t y = 0; y < dst.height; ++y)
+        {
+            const auto compactRow = y < row ? y : (y < row + (size_t) removed.y ? row - 1 : y - (size_t) removed.y);
+            const auto src = compact.getLinePointer (compactRow);
+            auto line = dst.getLinePointer (y);
+
+            memcpy (line, src, column);
+            if (removed.x > 0)
+                memset (line + column, src[column - 1], (size_t) removed.x);
+            memcpy (line + column + (size_t) removed.x, src + column, compact.width - column);
+        }
+    }
+
+    // Whether mask is a rectangle on whole pixels, so filling it gives nothing but 0s and 255s
+    // The blur of that is cheap to match to the pixel, unlike its closed form (every blur rounds down, some in between passes)
+    [[nodiscard]] static inline bool isAlignedRectangle (const RoundedRectangleMask& mask)
+    {
+        // JUCE fills in 256ths of a pixel, anything closer than half of one is the same fill
+        auto isWhole = [] (float value) { return std::abs (value - std::round (value)) < 1.0f / 512.0f; };
+        auto onWholePixels = [&] (juce::Rectangle<float> area) {
+            return isWhole (area.getX()) && isWhole (area.getY()) && isWhole (area.getRight()) && isWhole (area.getBottom());
+        };
+
+        // (around inner shadows only matters inside the image)
+        return (mask.shape.cornerSize.x <= 0 || mask.shape.cornerSize.y <= 0) && onWholePixels (mask.shape.area)
+               && (mask.around.isEmpty() || onWholePixels (mask.around) || mask.around.contains (juce::Rectangle<int> (mask.size.x, mask.size.y).toFloat()));
+    }
+
+    // Fills a mask on whole pixels in white, the way filling its path does (see isAlignedRectangle)
+    static inline void fillAlignedRectangle (const RoundedRectangleMask& mask, const ImageView& dst)
+    {
+        jassert (dst.pixelStride == 1 && dst.width == (size_t) mask.size.x && dst.height == (size_t) mask.size.y);
+        const juce::Rectangle<int> image (mask.size.x, mask.size.y);
+        const auto shape = mask.shape.area.toNearestIntEdges().getIntersection (image);
+
+        // inner shadows fill around the shape instead of it
+        const auto inner = !mask.around.isEmpty();
+        const auto around = inner ? mask.around.toNearestIntEdges().getIntersection (image) : juce::Rectangle<int>();
+
+        for (size_t y = 0; y < dst.height; ++y)
+        {
+            auto line = dst.getLinePointer (y);
+            memset (line, 0, dst.width);
+
+            if ((int) y >= around.getY() && (int) y < around.getBottom())
+                memset (line + around.getX(), 255, (size_t) around.getWidth());
+
+            if ((int) y >= shape.getY() && (int) y < shape.getBottom())
+                memset (line + shape.getX(), inner ? 0 : 255, (size_t) shape.getWidth());
+        }
+    }
+
+    // Whether two paths have the same elements, with points no further apart than tolerance
+    [[nodiscard]] static inline bool pathsMatch (const juce::Path& path, const juce::Path& candidate, float tolerance)
+    {
+        juce::Path::Iterator actual (path), expected (candidate);
+        auto isClose = [&] (float a, float b) { return std::abs (a - b) <= tolerance; };
+
+        while (true)
+        {
+            const auto hasActual = actual.next();
+            if (hasActual != expected.next())
+                return false;
+            if (! hasActual)
+                return true;
+
+            if (actual.elementType != expected.elementType)
+                return false;
+
+            // the iterator only fills in the points this type of element has
+            using Element = juce::Path::Iterator::PathElementType;
+            const auto numPoints = actual.elementType == Element::cubicTo ? 3 : (actual.elementType == Element::quadraticTo ? 2 : (actual.elementType == Element::closePath ? 0 : 1));
+            if ((numPoints > 0 && (! isClose (actual.x1, expected.x1) || ! isClose (actual.y1, expected.y1)))
+                || (numPoints > 1 && (! isClose (actual.x2, expected.x2) || ! isClose (actual.y2, expected.y2)))
+                || (numPoints > 2 && (! isClose (actual.x3, expected.x3) || ! isClose (actual.y3, expected.y3))))
+                return false;
+        }
+    }
+
+    // juce::Path builds rectangles and rounded rectangles the same way every time,
+    // so a path is one when it matches one rebuilt from its bounds (and where its first point says the corners start)
+    // Nothing else is, not even the same shape drawn another way, that just takes the regular blur
+    [[nodiscard]] static inline std::optional<RoundedRectangle> findRoundedRectangle (const juce::Path& path)
+    {
+        const auto bounds = path.getBounds();
+        if (bounds.isEmpty())
+            return std::nullopt;
+
+        juce::Path::Iterator firstElement (path);
+        if (! firstElement.next() || firstElement.elementType != juce::Path::Iterator::startNewSubPath)
+            return std::nullopt;
+
+        // anything closer than this won't show up in the shadow
+        const auto tolerance = 0.01f;
+
+        auto matches = [&] (const juce::Path& candidate) { return pathsMatch (path, candidate, tolerance); };
+
+        juce::Path rectangle;
+        rectangle.addRectangle (bounds);
+        if (matches (rectangle))
+            return RoundedRectangle { bounds, {} };
+
+        // a rounded rectangle starts cornerSize along one of its sides
+        const std::array<float, 5> cornerSizes { 0,
+            firstElement.x1 - bounds.getX(),
+            firstElement.y1 - bounds.getY(),
+            bounds.getRight() - firstElement.x1,
+            bounds.getBottom() - firstElement.y1 };
+
+        for (auto cornerSize : cornerSizes)
+        {
+            if (cornerSize < 0 || cornerSize > std::max (bounds.getWidth(), bounds.getHeight()))
+                continue;
+
+            juce::Path rounded;
+            rounded.addRoundedRectangle (bounds, cornerSize);
+
+            // (JUCE keeps the corners inside the rectangle, which can make them elliptical)
+            if (matches (rounded))
+                return RoundedRectangle { bounds, { std::min (cornerSize, bounds.getWidth() * 0.5f), std::min (cornerSize, bounds.getHeight() * 0.5f) } };
+        }
+
+        return std::nullopt;
+    }
+
+    /*
+     * The weights of a stack blur, in closed form.
+     * The pixel d away weighs (radius + 1 - |d|) / (radius + 1)^2, a triangle.
+     */
+    class StackBlurWeights
+    {
+    public:
+        explicit StackBlurWeights (size_t r) : radius ((int) r), scale (1.0 / (double) ((r + 1) * (r + 1))) {}
+
+        [[nodiscard]] int getRadius() const { return radius; }
+
+        // the weight of the pixel d away
+        [[nodiscard]] double at (int d) const
+        {
+            return std::abs (d) > radius ? 0.0 : (double) (radius + 1 - std::abs (d)) * scale;
+        }
+
+        // the weights of every pixel up to (and including) the one d away
+        [[nodiscard]] double upTo (int d) const
+        {
+            if (d < -radius)
+                return 0.0;
+            if (d >= radius)
+                return 1.0;
+            if (d > 0)
+                return 1.0 - upTo (-d - 1);
+
+            const auto n = (double) (d + radius + 1);
+            return n * (n + 1.0) * 0.5 * scale;
+        }
+
+        // pixel x's blur of everything right of edge (the pixel the edge is in counts as much as it's covered)
+        [[nodiscard]] double rightOf (double edge, int x) const
+        {
+            const auto u = (double) x + 1.0 - edge;
+            const auto whole = std::floor (u);
+            return upTo ((int) whole - 1) + (u - whole) * at ((int) whole);
+        }
+
+        // A line filled from start to end, blurred, with its first and last pixels repeated past the ends like the blur does
+        void blurLine (double start, double end, float* line, int length) const
+        {
+            start = std::clamp (start, 0.0, (double) length);
+            end = std::clamp (end, start, (double) length);
+            const auto first = std::max (0.0, std::min (end, 1.0) - start);
+            const auto last = std::max (0.0, end - std::max (start, (double) length - 1));
+
+            for (auto x = 0; x < length; ++x)
+                line[x] = (float) (rightOf (start, x) - rightOf (end, x) + first * upTo (-x - 1) + last * (1.0 - upTo (length - 1 - x)));
+        }
+
+        // The blur of rows of pixels (the same columns of each), down the column x, for the rows first - radius to last + radius
+        // The sums of sums of rows make each one a couple of lookups (the triangle is two boxes, one after the other)
+        template <typename Callback>
+        void blurColumn (const double* rows, int first, int numRows, size_t rowStride, Callback&& callback, double* sumsOfSums) const
+        {
+            auto sum = 0.0;
+            sumsOfSums[0] = 0.0;
+            for (auto i = 0; i < numRows; ++i)
+            {
+                sumsOfSums[i + 1] = sumsOfSums[i] + sum;
+                sum += rows[(size_t) i * rowStride];
+            }
+
+            // nothing before the first row, and every row after the last one
+            auto sumOfSumsBefore = [&] (int row) {
+                const auto i = row - first;
+                if (i <= 0)
+                    return 0.0;
+                if (i <= numRows)
+                    return sumsOfSums[i];
+                return sumsOfSums[numRows] + (double) (i - numRows) * sum;
+            };
+
+            for (auto y = first - radius; y < first + numRows + radius; ++y)
+                callback (y, (sumOfSumsBefore (y + radius + 2) - 2.0 * sumOfSumsBefore (y + 1) + sumOfSumsBefore (y - radius)) * scale);
+        }
+
+    private:
+        int radius;
+        double scale;
+    };
+
+    // Cuts the edge from (x0, y0) down to (x1, y1) into pieces that each stay inside one pixel
+    // callback gets the middle of each piece and how far down it goes
+    template <typename Callback>
+    static inline void forEachPixelPiece (double x0, double y0, double x1, double y1, Callback&& callback)
+    {
+        jassert (y1 > y0);
+        const auto dx = x1 - x0;
+        const auto dy = y1 - y0;
+
+        // the next whole row and column the edge crosses
+        auto nextRow = std::floor (y0) + 1.0;
+        auto nextColumn = dx > 0 ? std::floor (x0) + 1.0 : std::ceil (x0) - 1.0;
+
+        for (auto start = 0.0; start < 1.0;)
+        {
+            const auto atRow = (nextRow - y0) / dy;
+            const auto atColumn = std::abs (dx) > 0 ? (nextColumn - x0) / dx : 2.0;
+            const auto end = std::min ({ atRow, atColumn, 1.0 });
+
+            if (atRow <= end)
+                nextRow += 1.0;
+            if (atColumn <= end)
+                nextColumn += dx > 0 ? 1.0 : -1.0;
+
+            if (end > start)
+                callback (x0 + dx * (start + end) * 0.5, y0 + dy * (start + end) * 0.5, dy * (end - start));
+            start = end;
+        }
+    }
+
+    /*
+     * Adds sign times the blur of what the corners of outline cut out of its bounds, on one side.
+     *
+     * In a row, the cut goes from the bounds to the outline. Inside a pixel the outline is straight,
+     * and the blur of everything right of it changes linearly, so each of its pieces adds its height
+     * times the blur of the cut at its middle. That's the cut blurred along the rows, which is then blurred down the columns.
+     */
+    static inline void addBlurredCorners (const juce::Path& outline, juce::Rectangle<float> bounds, bool leftSide, const StackBlurWeights& weights, float sign, float* blurred, juce::Point<int> size)
+    {
+        // callback gets the row of each cut, and where it starts and ends
+        auto forEachCut = [&] (auto&& callback) {
+            for (juce::PathFlatteningIterator edge (outline); edge.next();)
+            {
+                if (!juce::approximatelyEqual (edge.y1, edge.y2) && ((edge.x1 + edge.x2) * 0.5f < bounds.getCentreX()) == leftSide)
+                {
+                    const auto down = edge.y2 > edge.y1;
+                    forEachPixelPiece (down ? edge.x1 : edge.x2, down ? edge.y1 : edge.y2, down ? edge.x2 : edge.x1, down ? edge.y2 : edge.y1, [&] (double x, double y, double height) {
+                        const auto start = leftSide ? (double) bounds.getX() : x;
+                        const auto end = leftSide ? x : (double) bounds.getRight();
+                        if (end > start)
+                            callback ((int) std::floor (y), start, end, height);
+                    });
+                }
+            }
+        };
+
+        // the rows with a cut, and the columns their blur reaches
+        auto firstRow = std::numeric_limits<int>::max(), lastRow = std::numeric_limits<int>::min();
+        auto cutStart = std::numeric_limits<double>::max(), cutEnd = std::numeric_limits<double>::lowest();
+        forEachCut ([&] (int row, double start, double end, double) {
+            firstRow = std::min (firstRow, row);
+            lastRow = std::max (lastRow, row);
+            cutStart = std::min (cutStart, start);
+            cutEnd = std::max (cutEnd, end);
+        });
+
+        if (firstRow > lastRow)
+            return;
+
+        const auto radius = weights.getRadius();
+        const auto firstColumn = std::max (0, (int) std::floor (cutStart) - radius);
+        const auto lastColumn = std::min (size.x - 1, (int) std::floor (cutEnd) + radius);
+        if (firstColumn > lastColumn)
+            return;
+
+        const auto numRows = lastRow - firstRow + 1;
+        const auto numColumns = (size_t) (lastColumn - firstColumn + 1);
+        ScratchFrame scratch;
+        auto rows = scratch.allocateZeroed<double> ((size_t) numRows * numColumns);
+        auto sumsOfSums = scratch.allocate<double> ((size_t) numRows + 1);
+
+        forEachCut ([&] (int row, double start, double end, double height) {
+            auto line = rows + (size_t) (row - firstRow) * numColumns;
+            const auto from = std::max (firstColumn, (int) std::floor (start) - radius);
+            const auto to = std::min (lastColumn, (int) std::floor (end) + radius);
+            for (auto x = from; x <= to; ++x)
+                line[x - firstColumn] += height * (weights.rightOf (start, x) - weights.rightOf (end, x));
+        });
+
+        for (auto x = firstColumn; x <= lastColumn; ++x)
+        {
+            weights.blurColumn (rows + (x - firstColumn), firstRow, numRows, numColumns, [&] (int y, double value) {
+                if (y >= 0 && y < size.y)
+                    blurred[(size_t) y * (size_t) size.x + (size_t) x] += sign * (float) value;
+            }, sumsOfSums);
+        }
+    }
+
+    /*
+     * The stack blur of mask (filled like JUCE fills its path), calculated straight into dst.
+     *
+     * The shape has to be at least the radius inside dst, like it is in a shadow's image:
+     * only the rectangle around inner shadows repeats its edges the way the blur does.
+     */
+    static inline void renderRoundedRectangleShadow (const RoundedRectangleMask& mask, size_t radius, const ImageView& dst)
+    {
+        jassert (dst.pixelStride == 1 && dst.width == (size_t) mask.size.x && dst.height == (size_t) mask.size.y);
+        if (dst.isEmpty())
+            return;
+
+        const StackBlurWeights weights (radius);
+        const auto width = mask.size.x;
+        const auto height = mask.size.y;
+        const auto& area = mask.shape.area;
+        const auto inner = !mask.around.isEmpty();
+
+        // the shape's bounds blur to the product of their blurred columns and rows
+        ScratchFrame scratch;
+        auto columns = scratch.allocate<float> ((size_t) width);
+        auto rows = scratch.allocate<float> ((size_t) height);
+        weights.blurLine (area.getX(), area.getRight(), columns, width);
+        weights.blurLine (area.getY(), area.getBottom(), rows, height);
+
+        auto aroundColumns = columns;
+        auto aroundRows = rows;
+        if (inner)
+        {
+            aroundColumns = scratch.allocate<float> ((size_t) width);
+            aroundRows = scratch.allocate<float> ((size_t) height);
+            weights.blurLine (mask.around.getX(), mask.around.getRight(), aroundColumns, width);
+            weights.blurLine (mask.around.getY(), mask.around.getBottom(), aroundRows, height);
+        }
+
+        // inner shadows are everything around the shape, minus the shape
+        auto blurred = scratch.allocate<float> ((size_t) width * (size_t) height);
+        for (auto y = 0; y < height; ++y)
+        {
+            auto line = blurred + (size_t) y * (size_t) width;
+            for (auto x = 0; x < width; ++x)
+                line[x] = inner ? aroundColumns[x] * aroundRows[y] - columns[x] * rows[y] : columns[x] * rows[y];
+        }
+
+        // the corners cut some of that out of the bounds (and add it to inner shadows)
+        if (mask.shape.cornerSize.x > 0 && mask.shape.cornerSize.y > 0)
+        {
+            juce::Path outline;
+            outline.addRoundedRectangle (area.getX(), area.getY(), area.getWidth(), area.getHeight(), mask.shape.cornerSize.x, mask.shape.cornerSize.y);
+            addBlurredCorners (outline, area, true, weights, inner ? 1.0f : -1.0f, blurred, mask.size);
+            addBlurredCorners (outline, area, false, weights, inner ? 1.0f : -1.0f, blurred, mask.size);
+        }
+
+        // rounded down, like the blur
+        for (auto y = 0; y < height; ++y)
+        {
+            const auto line = blurred + (size_t) y * (size_t) width;
+            auto out = dst.getLinePointer ((size_t) y);
+            for (auto x = 0; x < width; ++x)
+                out[x] = (uint8_t) juce::jlimit (0.0f, 255.0f, line[x] * 255.0f);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "../scratch_memory.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace melatonin::blur
+{
+    // Every allocation starts on a cache line, which is also enough for any vector load
+    static constexpr size_t scratchAlignment = 64;
+
+    /*
+     * Hands out memory from the calling thread's scratch block, a bit like the stack:
+     * everything a frame hands out is given back when the frame is destroyed.
+     * Frames can nest (a blur calling another blur), the inner one has to go first.
+     *
+     * The memory is uninitialized, like a HeapBlock. Use allocateZeroed when that matters.
+     * Frames are per thread, so a parallel task makes its own frame rather than sharing the caller's.
+     */
+    class ScratchFrame
+    {
+    public:
+        ScratchFrame();
+        ~ScratchFrame();
+
+        ScratchFrame (const ScratchFrame&) = delete;
+        ScratchFrame& operator= (const ScratchFrame&) = delete;
+
+        template <typename T>
+        [[nodiscard]] T* allocate (size_t count)
+        {
+            return static_cast<T*> (allocateBytes (count * sizeof (T)));
+        }
+
+        template <typename T>
+        [[nodiscard]] T* allocateZeroed (size_t count)
+        {
+            auto memory = allocate<T> (count);
+            std::fill_n (memory, count, T {});
+            return memory;
+        }
+
+    private:
+        void* allocateBytes (size_t numBytes);
+
+        size_t numRetiredBlocks;
+        size_t used;
+    };
+}
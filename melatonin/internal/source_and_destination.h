@@ -0,0 +1,89 @@
+#pragma once
+#include "../image_view.h"
+#include "juce_graphics/juce_graphics.h"
+#include <cstring>
+#include <optional>
+
+namespace melatonin::blur
+{
+    /*
+     * Most kernels start by transposing the image into scratch memory,
+     * so they can just as well read from one image and write to another.
+     * That saves callers a copy (and an allocation) of the source on every blur.
+     *
+     * Passing the same view as source and destination blurs in place.
+     * Otherwise the two mustn't overlap.
+     */
+    class SourceAndDestination
+    {
+    public:
+        SourceAndDestination (const ImageView& src, const ImageView& dst)
+            : sourcePixels (src), destinationPixels (dst)
+        {
+            // dst has to be allocated already, with the same size and format
+            jassert (src.width == dst.width && src.height == dst.height);
+            jassert (src.pixelStride == dst.pixelStride);
+        }
+
+        [[nodiscard]] bool isInPlace() const { return sourcePixels == destinationPixels; }
+
+        [[nodiscard]] const uint8_t* source() const { return sourcePixels.data; }
+        [[nodiscard]] size_t sourceLineStride() const { return sourcePixels.lineStride; }
+
+        [[nodiscard]] uint8_t* destination() const { return destinationPixels.data; }
+        [[nodiscard]] size_t destinationLineStride() const { return destinationPixels.lineStride; }
+
+        [[nodiscard]] size_t width() const { return destinationPixels.width; }
+        [[nodiscard]] size_t height() const { return destinationPixels.height; }
+        [[nodiscard]] size_t pixelStride() const { return destinationPixels.pixelStride; }
+
+        // For the kernels that only blur in place: copies these rows over first (when they aren't the same rows)
+        void copyRows (size_t firstRow, size_t numRows) const
+        {
+            if (isInPlace())
+                return;
+
+            for (auto y = firstRow; y < firstRow + numRows; ++y)
+                memcpy (destinationPixels.getLinePointer (y), sourcePixels.getLinePointer (y), width() * pixelStride());
+        }
+
+        [[nodiscard]] const ImageView& destinationView() const { return destinationPixels; }
+
+    private:
+        ImageView sourcePixels;
+        ImageView destinationPixels;
+    };
+
+    // A view of a juce::Image's pixels, for as long as the BitmapData is around
+    [[nodiscard]] static inline ImageView viewOf (const juce::Image::BitmapData& data)
+    {
+        return { data.data, (size_t) data.width, (size_t) data.height, (size_t) data.lineStride, (size_t) data.pixelStride };
+    }
+
+    /*
+     * Maps a source and a destination juce::Image, so the view based kernels can blur from one to the other.
+     * The same image is only mapped once, as mapping it twice for writing isn't safe on every image type.
+     * The views are good for as long as this is around.
+     */
+    class MappedImages
+    {
+    public:
+        MappedImages (const juce::Image& src, juce::Image& dst)
+            : destinationData (dst, juce::Image::BitmapData::readWrite)
+        {
+            // dst has to be allocated already, with the same size and format
+            jassert (src.getBounds() == dst.getBounds());
+            jassert (src.getFormat() == dst.getFormat());
+
+            if (src != dst)
+                sourceData.emplace (src, juce::Image::BitmapData::readOnly);
+        }
+
+        [[nodiscard]] ImageView source() const { return viewOf (sourceData ? *sourceData : destinationData); }
+        [[nodiscard]] ImageView destination() const { return viewOf (destinationData); }
+
+    private:
+        juce::Image::BitmapData destinationData;
+        std::optional<juce::Image::BitmapData> sourceData;
+    };
+}
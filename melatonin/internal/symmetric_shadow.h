@@ -0,0 +1,81 @@
+#pragma once
+#include "../image_view.h"
+#include "juce_graphics/juce_graphics.h"
+#include "rounded_rectangle_shadow.h"
+#include <algorithm>
+#include <cstring>
+
+/*
+ * Shadows of shapes that are symmetric both ways, like the ellipses and circles of knobs and dots.
+ *
+ * The stack blur's kernel is symmetric too, so blurring a mirrored image gives the mirrored blur.
+ * When the filled path is mirrored both ways, only its top left quarter is blurred
+ * (plus as far as the blur reaches, which the quarter's blur reads), and the other three are copies of it.
+ *
+ * JUCE's antialiasing isn't always symmetric (odd sizes, fractional positions), so the path is still filled
+ * in full, and it's only the pixels that decide whether it's mirrored.
+ */
+namespace melatonin::blur
+{
+    // juce::Path builds ellipses the same way every time, so a path is one when it matches one rebuilt from its bounds
+    [[nodiscard]] static inline bool isEllipse (const juce::Path& path)
+    {
+        const auto bounds = path.getBounds();
+        if (bounds.isEmpty())
+            return false;
+
+        juce::Path ellipse;
+        ellipse.addEllipse (bounds);
+
+        // anything closer than this won't show up in the shadow
+        return pathsMatch (path, ellipse, 0.01f);
+    }
+
+    // Whether every row reads the same backwards, and the rows from the bottom up are the rows from the top down
+    [[nodiscard]] static inline bool isMirrored (const ImageView& image)
+    {
+        jassert (image.pixelStride == 1);
+
+        for (size_t y = 0; y < image.height / 2; ++y)
+            if (memcmp (image.getLinePointer (y), image.getLinePointer (image.height - 1 - y), image.width) != 0)
+                return false;
+
+        for (size_t y = 0; y < (image.height + 1) / 2; ++y)
+        {
+            const auto line = image.getLinePointer (y);
+            for (size_t x = 0; x < image.width / 2; ++x)
+                if (line[x] != line[image.width - 1 - x])
+                    return false;
+        }
+
+        return true;
+    }
+
+    // The top left quarter of an image, with the middle row or column when there's an odd number of them
+    [[nodiscard]] static inline juce::Point<int> quarterSize (juce::Point<int> imageSize)
+    {
+        return { (imageSize.x + 1) / 2, (imageSize.y + 1) / 2 };
+    }
+
+    // Fills dst with 4 copies of quarter (the top left of dst), mirrored into the other three
+    static inline void mirrorQuarter (const ImageView& quarter, const ImageView& dst)
+    {
+        jassert (quarter.pixelStride == 1 && dst.pixelStride == 1);
+        jassert (quarter.width == (dst.width + 1) / 2 && quarter.height == (dst.height + 1) / 2);
+
+        // the right half of a row is its left half backwards (less the middle pixel, for odd widths)
+        const auto numMirrored = dst.width - quarter.width;
+        for (size_t y = 0; y < quarter.height; ++y)
+        {
+            const auto src = quarter.getLinePointer (y);
+            auto line = dst.getLinePointer (y);
+            if (src != line)
+                memcpy (line, src, quarter.width);
+            std::reverse_copy (line, line + numMirrored, line + quarter.width);
+        }
+
+        // and the bottom half is the top half upside down
+        for (auto y = quarter.height; y < dst.height; ++y)
+            memcpy (dst.getLinePointer (y), dst.getLinePointer (dst.height - 1 - y), dst.width);
+    }
+}
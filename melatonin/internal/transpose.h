@@ -0,0 +1,137 @@
+#pragma once
+#include "juce_core/juce_core.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if JUCE_INTEL
+    #include <emmintrin.h>
+#endif
+
+namespace melatonin::blur
+{
+#if JUCE_INTEL
+    // SSE2 is available on every x86-64 CPU, so no runtime dispatch is needed here
+    // Each round interleaves row i with row i + n/2. log2(n) rounds of that is a transpose
+    template <typename Pixel>
+    struct SSE2TransposeBlock;
+
+    // 16x16 single channel pixels
+    template <>
+    struct SSE2TransposeBlock<uint8_t>
+    {
+        static constexpr size_t size = 16;
+
+        static inline void transpose (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride)
+        {
+            __m128i rows[16], interleaved[16];
+            for (size_t i = 0; i < 16; ++i)
+                rows[i] = _mm_loadu_si128 ((const __m128i*) (src + i * srcLineStride));
+
+            for (size_t round = 0; round < 4; ++round)
+            {
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    interleaved[2 * i] = _mm_unpacklo_epi8 (rows[i], rows[i + 8]);
+                    interleaved[2 * i + 1] = _mm_unpackhi_epi8 (rows[i], rows[i + 8]);
+                }
+                std::copy (std::begin (interleaved), std::end (interleaved), std::begin (rows));
+            }
+
+            for (size_t i = 0; i < 16; ++i)
+                _mm_storeu_si128 ((__m128i*) (dst + i * dstLineStride), rows[i]);
+        }
+    };
+
+    // 4x4 ARGB pixels
+    template <>
+    struct SSE2TransposeBlock<uint32_t>
+    {
+        static constexpr size_t size = 4;
+
+        static inline void transpose (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride)
+        {
+            __m128i rows[4], interleaved[4];
+            for (size_t i = 0; i < 4; ++i)
+                rows[i] = _mm_loadu_si128 ((const __m128i*) (src + i * srcLineStride));
+
+            for (size_t round = 0; round < 2; ++round)
+            {
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    interleaved[2 * i] = _mm_unpacklo_epi32 (rows[i], rows[i + 2]);
+                    interleaved[2 * i + 1] = _mm_unpackhi_epi32 (rows[i], rows[i + 2]);
+                }
+                std::copy (std::begin (interleaved), std::end (interleaved), std::begin (rows));
+            }
+
+            for (size_t i = 0; i < 4; ++i)
+                _mm_storeu_si128 ((__m128i*) (dst + i * dstLineStride), rows[i]);
+        }
+    };
+#endif
+
+    /*
+     * Cache-blocked transpose: what was column x of src becomes row x of dst.
+     *
+     * Stack blur's vertical pass is the fast one, as it works on entire contiguous rows at once.
+     * The horizontal pass has to gather one pixel from every row, which misses cache on every access.
+     * So instead, we transpose, run the vertical pass and transpose back.
+     *
+     * Walking in small square tiles (a cache line wide) keeps both the reads and the writes in cache.
+     * Pixel is uint8_t for single channel images and uint32_t for ARGB (all 4 channels move together).
+     */
+    template <typename Pixel, size_t tileSize = 64 / sizeof (Pixel)>
+    static void transpose (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t srcWidth, size_t srcHeight)
+    {
+        for (size_t tileY = 0; tileY < srcHeight; tileY += tileSize)
+        {
+            const auto tileBottom = std::min (tileY + tileSize, srcHeight);
+
+            for (size_t tileX = 0; tileX < srcWidth; tileX += tileSize)
+            {
+                const auto tileRight = std::min (tileX + tileSize, srcWidth);
+
+#if JUCE_INTEL
+                // do whole blocks in registers, only the ragged edges go pixel by pixel
+                using Block = SSE2TransposeBlock<Pixel>;
+                constexpr auto blockSize = Block::size;
+#else
+                constexpr size_t blockSize = tileSize;
+#endif
+                for (size_t blockY = tileY; blockY < tileBottom; blockY += blockSize)
+                {
+                    for (size_t blockX = tileX; blockX < tileRight; blockX += blockSize)
+                    {
+                        auto blockSrc = src + blockY * srcLineStride + blockX * sizeof (Pixel);
+                        auto blockDst = dst + blockX * dstLineStride + blockY * sizeof (Pixel);
+                        const auto blockWidth = std::min (blockSize, tileRight - blockX);
+                        const auto blockHeight = std::min (blockSize, tileBottom - blockY);
+
+#if JUCE_INTEL
+                        if (blockWidth == blockSize && blockHeight == blockSize)
+                        {
+                            Block::transpose (blockSrc, srcLineStride, blockDst, dstLineStride);
+                            continue;
+                        }
+#endif
+                        for (size_t y = 0; y < blockHeight; ++y)
+                            for (size_t x = 0; x < blockWidth; ++x)
+                                memcpy (blockDst + x * dstLineStride + y * sizeof (Pixel), blockSrc + y * srcLineStride + x * sizeof (Pixel), sizeof (Pixel));
+                    }
+                }
+            }
+        }
+    }
+
+    // Same as above, split into bands of source rows for multithreading
+    template <typename Pixel>
+    static void transpose (const uint8_t* src, size_t srcLineStride, uint8_t* dst, size_t dstLineStride, size_t srcWidth, size_t srcHeight, size_t numTasks)
+    {
+        forEachBandInParallel (srcHeight, numTasks, 64, [&] (size_t y, size_t rows) {
+            transpose<Pixel> (src + y * srcLineStride, srcLineStride, dst + y * sizeof (Pixel), dstLineStride, srcWidth, rows);
+        });
+    }
+}
@@ -0,0 +1,123 @@
+#include "multithreading.h"
+#include "internal/parallel.h"
+
+namespace melatonin::blur
+{
+    namespace
+    {
+        // Callers take a copy of the shared_ptr, so the pool can be
+        // swapped out or disabled while a blur is still running on it
+        std::mutex poolMutex;
+        std::shared_ptr<juce::ThreadPool> workerPool;
+
+        // 256x256, below that it's not worth waking up threads
+        std::atomic<size_t> multithreadingThreshold { 65536 };
+
+        std::shared_ptr<juce::ThreadPool> getWorkerPool()
+        {
+            const std::lock_guard<std::mutex> lock (poolMutex);
+            return workerPool;
+        }
+    }
+
+    void enableMultithreading (int numWorkerThreads)
+    {
+        if (numWorkerThreads <= 0)
+            numWorkerThreads = juce::jmax (1, juce::SystemStats::getNumCpus() - 1);
+
+        auto pool = std::make_shared<juce::ThreadPool> (numWorkerThreads);
+        const std::lock_guard<std::mutex> lock (poolMutex);
+        workerPool = std::move (pool);
+    }
+
+    void disableMultithreading()
+    {
+        std::shared_ptr<juce::ThreadPool> oldPool;
+        {
+            const std::lock_guard<std::mutex> lock (poolMutex);
+            std::swap (oldPool, workerPool);
+        }
+
+        if (oldPool == nullptr)
+            return;
+
+        // A blur still running on the pool does the jobs that haven't started yet itself,
+        // so those can go, and the running ones are waited for
+        oldPool->removeAllJobs (false, -1);
+
+        // then the blurs let go of their copies, and the pool's threads are stopped here, outside the lock
+        while (oldPool.use_count() > 1)
+            juce::Thread::yield();
+
+        oldPool.reset();
+    }
+
+    bool isMultithreadingEnabled()
+    {
+        return getWorkerPool() != nullptr;
+    }
+
+    void setMultithreadingThreshold (size_t minimumNumPixels)
+    {
+        multithreadingThreshold = minimumNumPixels;
+    }
+
+    size_t parallelTasksFor (size_t numPixels)
+    {
+        if (numPixels < multithreadingThreshold)
+            return 1;
+
+        if (auto pool = getWorkerPool())
+            return (size_t) pool->getNumThreads() + 1;
+
+        return 1;
+    }
+
+    void runInParallel (size_t numTasks, ParallelTask task, void* context)
+    {
+        auto pool = numTasks > 1 ? getWorkerPool() : nullptr;
+        if (pool == nullptr)
+        {
+            for (size_t i = 0; i < numTasks; ++i)
+                task (context, i);
+            return;
+        }
+
+        // Shared with the pool jobs, which might only get around to starting after everything is done
+        struct Work
+        {
+            ParallelTask task;
+            void* context;
+            size_t numTasks;
+            std::atomic<size_t> next { 0 };
+            std::atomic<size_t> done { 0 };
+            juce::WaitableEvent finished;
+
+            void run()
+            {
+                // whoever is free grabs the next task
+                for (auto i = next++; i < numTasks; i = next++)
+                {
+                    task (context, i);
+                    if (++done == numTasks)
+                        finished.signal();
+                }
+            }
+        };
+
+        auto work = std::make_shared<Work>();
+        work->task = task;
+        work->context = context;
+        work->numTasks = numTasks;
+
+        const auto numHelpers = std::min (numTasks - 1, (size_t) pool->getNumThreads());
+        for (size_t i = 0; i < numHelpers; ++i)
+            pool->addJob ([work] {
+                work->run();
+                return juce::ThreadPoolJob::jobHasFinished;
+            });
+
+        work->run();
+        work->finished.wait();
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+namespace melatonin::blur
+{
+    /*
+     * Multithreaded blurring is opt-in and off by default.
+     *
+     * Once enabled, big blurs (full window backgrounds, etc) are split into bands
+     * of rows and columns and spread across a small pool of worker threads.
+     * The calling thread does its share of the work and waits for the rest,
+     * so the blur is still finished when the call returns.
+     *
+     * Small blurs (most shadows) stay on the calling thread,
+     * where handing work off would cost more than it saves.
+     *
+     * Call disableMultithreading before your app shuts down (in your JUCEApplication's shutdown
+     * or your plugin's destructor). It stops the worker threads right away, once the blurs using them are done.
+     * Otherwise they're only stopped during static destruction, after JUCE itself is gone.
+     */
+
+    // 0 worker threads means one less than the number of CPU cores (the calling thread is the other one)
+    void enableMultithreading (int numWorkerThreads = 0);
+    void disableMultithreading();
+    [[nodiscard]] bool isMultithreadingEnabled();
+
+    // Images with fewer pixels than this are always blurred on the calling thread
+    void setMultithreadingThreshold (size_t minimumNumPixels);
+}
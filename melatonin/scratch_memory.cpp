@@ -0,0 +1,153 @@
+#include "scratch_memory.h"
+#include "internal/scratch.h"
+
+namespace melatonin::blur
+{
+    namespace
+    {
+        // trimScratchMemory bumps the generation, each thread notices the next time it starts blurring
+        std::atomic<uint64_t> scratchGeneration { 0 };
+        std::atomic<size_t> scratchTrimSize { 0 };
+
+        struct AlignedDelete
+        {
+            void operator() (uint8_t* memory) const { ::operator delete (memory, std::align_val_t (scratchAlignment)); }
+        };
+
+        using ScratchBlock = std::unique_ptr<uint8_t[], AlignedDelete>;
+
+        ScratchBlock allocateScratchBlock (size_t numBytes)
+        {
+            return ScratchBlock (static_cast<uint8_t*> (::operator new (numBytes, std::align_val_t (scratchAlignment))));
+        }
+
+        struct ScratchArena
+        {
+            // new allocations come from here
+            ScratchBlock block;
+            size_t capacity = 0;
+            size_t used = 0;
+
+            // blocks that ran out of room while a frame was still using them
+            std::vector<std::pair<ScratchBlock, size_t>> retired;
+            size_t retiredBytes = 0;
+
+            size_t depth = 0;
+            uint64_t generation = 0;
+
+            void applyTrim()
+            {
+                const auto latest = scratchGeneration.load();
+                if (generation == latest || depth > 0)
+                    return;
+
+                generation = latest;
+                if (capacity > scratchTrimSize.load())
+                {
+                    block.reset();
+                    capacity = 0;
+                    used = 0;
+                }
+            }
+
+            void* allocate (size_t numBytes)
+            {
+                // every allocation gets its own cache lines (and a zero sized one still gets a valid pointer)
+                numBytes = std::max (scratchAlignment, (numBytes + scratchAlignment - 1) / scratchAlignment * scratchAlignment);
+
+                if (used + numBytes > capacity)
+                {
+                    if (block != nullptr)
+                    {
+                        retiredBytes += capacity;
+                        retired.emplace_back (std::move (block), capacity);
+                    }
+
+                    capacity = std::max (numBytes, 2 * capacity);
+                    block = allocateScratchBlock (capacity);
+                    used = 0;
+                }
+
+                auto memory = block.get() + used;
+                used += numBytes;
+                return memory;
+            }
+
+            void endFrame (size_t numRetiredBlocks, size_t previouslyUsed)
+            {
+                --depth;
+
+                if (retired.size() > numRetiredBlocks)
+                {
+                    // the frame's own block was retired while it ran (outer frames might still use it)
+                    // anything retired after that was only used by this frame
+                    while (retired.size() > numRetiredBlocks + 1)
+                    {
+                        retiredBytes -= retired.back().second;
+                        retired.pop_back();
+                    }
+                    used = 0;
+                }
+                else
+                {
+                    used = previouslyUsed;
+                }
+
+                // all done: swap the pieces for one block big enough for all of them
+                // so next time, the same blur fits without growing
+                if (depth == 0 && ! retired.empty())
+                {
+                    const auto total = capacity + retiredBytes;
+                    retired.clear();
+                    retiredBytes = 0;
+                    block = allocateScratchBlock (total);
+                    capacity = total;
+                    used = 0;
+                }
+            }
+        };
+
+        ScratchArena& getThreadArena()
+        {
+            thread_local ScratchArena arena;
+            return arena;
+        }
+    }
+
+    ScratchFrame::ScratchFrame()
+    {
+        auto& arena = getThreadArena();
+        arena.applyTrim();
+        ++arena.depth;
+        numRetiredBlocks = arena.retired.size();
+        used = arena.used;
+    }
+
+    ScratchFrame::~ScratchFrame()
+    {
+        getThreadArena().endFrame (numRetiredBlocks, used);
+    }
+
+    void* ScratchFrame::allocateBytes (size_t numBytes)
+    {
+        return getThreadArena().allocate (numBytes);
+    }
+
+    void releaseScratchMemory()
+    {
+        trimScratchMemory (0);
+    }
+
+    void trimScratchMemory (size_t maxBytesPerThread)
+    {
+        scratchTrimSize = maxBytesPerThread;
+        ++scratchGeneration;
+        getThreadArena().applyTrim();
+    }
+
+    size_t getScratchMemorySize()
+    {
+        const auto& arena = getThreadArena();
+        return arena.capacity + arena.retiredBytes;
+    }
+}
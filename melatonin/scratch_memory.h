@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+namespace melatonin::blur
+{
+    /*
+     * Blurs need temporary buffers: transposed copies of the image, queues, sums.
+     *
+     * Instead of allocating them on every blur, each thread keeps one block of scratch memory
+     * and reuses it. It only grows (to fit the biggest blur that thread has done),
+     * so repeated blurs of the same size (resizing, animating) never touch the allocator.
+     *
+     * Threads free their scratch memory when they exit.
+     * These let you hand it back sooner, for example after a one-off huge blur.
+     */
+
+    // Every thread drops its scratch memory the next time it blurs (the calling thread right away)
+    void releaseScratchMemory();
+
+    // Same, but threads keep their scratch memory if it's no bigger than this
+    void trimScratchMemory (size_t maxBytesPerThread);
+
+    // How much scratch memory the calling thread is holding on to
+    [[nodiscard]] size_t getScratchMemorySize();
+}
@@ -1,4 +1,6 @@
 #include "melatonin_blur.h"
+#include "melatonin/multithreading.cpp"
+#include "melatonin/scratch_memory.cpp"
 #include "melatonin/cached_blur.cpp"
 #include "melatonin/internal/cached_shadows.cpp"
 #include "melatonin/internal/rendered_single_channel_shadow.cpp"
@@ -9,6 +11,8 @@
 
 #if RUN_MELATONIN_BLUR_TESTS
     #include "tests/blur_implementations.cpp"
+    #include "tests/cached_blur.cpp"
+    #include "tests/render_single_channel.cpp"
     #include "tests/drop_shadow.cpp"
     #include "tests/inner_shadow.cpp"
     #include "tests/shadow_scaling.cpp"
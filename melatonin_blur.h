@@ -18,6 +18,10 @@ END_JUCE_MODULE_DECLARATION
 #include "juce_graphics/juce_graphics.h"
 #include "juce_gui_basics/juce_gui_basics.h"
 
+#include "melatonin/multithreading.h"
+#include "melatonin/scratch_memory.h"
+#include "melatonin/blur_kernel.h"
+#include "melatonin/image_view.h"
 #include "melatonin/cached_blur.h"
 #include "melatonin/shadows.h"
 #include "melatonin/blur_demo_component.h"
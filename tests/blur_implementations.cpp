@@ -49,7 +49,7 @@ inline auto rgbaBlurImplementation()
         std::make_pair ("gin", BlurFunction { [] (juce::Image& img, size_t radius) { melatonin::stackBlur::ginARGB (img, (unsigned int) radius); } }),
         std::make_pair ("juce's FloatVectorOperations", BlurFunction { [&] (juce::Image& img, size_t radius) { melatonin::blur::juceFloatVectorARGB (img, radius); } }),
         std::make_pair ("Melatonin", BlurFunction { [&] (juce::Image& img, size_t radius) {
-            // argb goes haywire in-place, so we need to copy
+            // reads from a copy, to check the out of place path
             auto src = img.createCopy();
             melatonin::blur::argb (src, img, radius);
         } }));
@@ -619,3 +619,608 @@ TEST_CASE ("Melatonin Blur")
         }
     }
 }
+
+#if MELATONIN_BLUR_SIMD
+TEST_CASE ("Melatonin Blur SIMD kernels")
+{
+    // odd sizes exercise the leftover (non-vector) lanes
+    auto width = GENERATE (1, 7, 33, 100);
+    auto height = GENERATE (1, 9, 64);
+    auto radius = GENERATE (1, 2, 5, 16, 17, 20, 254);
+
+    juce::Image reference (juce::Image::PixelFormat::SingleChannel, width, height, true);
+    {
+        juce::Random random (width * 1000 + height);
+        juce::Image::BitmapData data (reference, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width; ++x)
+                data.getPixelPointer (x, y)[0] = (uint8_t) random.nextInt (256);
+    }
+
+    using BlurReference = void (*) (juce::Image&, size_t);
+    auto checkKernel = [&] (BlurReference referenceBlur, melatonin::blur::simd::SingleChannelKernel kernel) {
+        auto expected = reference.createCopy();
+        referenceBlur (expected, (size_t) radius);
+
+        auto actual = reference.createCopy();
+        {
+            juce::Image::BitmapData data (actual, juce::Image::BitmapData::readWrite);
+            kernel (data.getLinePointer (0), (size_t) width, (size_t) height, (size_t) data.lineStride, (size_t) radius);
+        }
+        REQUIRE (imagesAreIdentical (expected, actual));
+    };
+
+    // the float kernels match juce's FloatVectorOperations, the integer kernels match gin
+    auto floatReference = [] (juce::Image& img, size_t r) { melatonin::blur::juceFloatVectorSingleChannel (img, r); };
+    auto ginReference = [] (juce::Image& img, size_t r) { melatonin::stackBlur::ginSingleChannel (img, (unsigned int) r); };
+
+    DYNAMIC_SECTION (width << "x" << height << " radius " << radius)
+    {
+        SECTION ("SSE2")
+        {
+            checkKernel (floatReference, &melatonin::blur::simd::sse2::floatSingleChannel);
+            checkKernel (ginReference, &melatonin::blur::simd::sse2::integerSingleChannel);
+        }
+
+        SECTION ("AVX2")
+        {
+            if (juce::SystemStats::hasAVX2())
+            {
+                checkKernel (floatReference, &melatonin::blur::simd::avx2::floatSingleChannel);
+                checkKernel (ginReference, &melatonin::blur::simd::avx2::integerSingleChannel);
+            }
+        }
+
+        SECTION ("AVX-512")
+        {
+            if (juce::SystemStats::hasAVX512F())
+            {
+                checkKernel (floatReference, &melatonin::blur::simd::avx512::floatSingleChannel);
+                checkKernel (ginReference, &melatonin::blur::simd::avx512::integerSingleChannel);
+            }
+        }
+    }
+}
+
+TEST_CASE ("Melatonin Blur SIMD ARGB kernels")
+{
+    auto width = GENERATE (1, 3, 17, 100);
+    auto height = GENERATE (1, 9, 64);
+    auto radius = GENERATE (2, 3, 16, 17, 20, 254);
+
+    juce::Image reference (juce::Image::PixelFormat::ARGB, width, height, true);
+    {
+        juce::Random random (width * 1000 + height);
+        juce::Image::BitmapData data (reference, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width * 4; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+
+    auto expected = reference.createCopy();
+    melatonin::stackBlur::ginARGB (expected, (unsigned int) radius);
+
+    auto checkKernel = [&] (melatonin::blur::simd::ARGBKernel kernel) {
+        // in place
+        auto actual = reference.createCopy();
+        {
+            juce::Image::BitmapData data (actual, juce::Image::BitmapData::readWrite);
+            kernel (data.getLinePointer (0), (size_t) data.lineStride, data.getLinePointer (0), (size_t) data.lineStride, (size_t) width, (size_t) height, (size_t) radius);
+        }
+        REQUIRE (imagesAreIdentical (expected, actual));
+
+        // out of place, into an image with garbage in it
+        juce::Image outOfPlace (juce::Image::PixelFormat::ARGB, width, height, false);
+        {
+            juce::Image::BitmapData src (reference, juce::Image::BitmapData::readOnly);
+            juce::Image::BitmapData dst (outOfPlace, juce::Image::BitmapData::writeOnly);
+            kernel (src.getLinePointer (0), (size_t) src.lineStride, dst.getLinePointer (0), (size_t) dst.lineStride, (size_t) width, (size_t) height, (size_t) radius);
+        }
+        REQUIRE (imagesAreIdentical (expected, outOfPlace));
+    };
+
+    DYNAMIC_SECTION (width << "x" << height << " radius " << radius)
+    {
+        SECTION ("SSE2")
+        {
+            checkKernel (&melatonin::blur::simd::sse2::integerARGB);
+        }
+
+        SECTION ("AVX2")
+        {
+            if (juce::SystemStats::hasAVX2())
+                checkKernel (&melatonin::blur::simd::avx2::integerARGB);
+        }
+
+        SECTION ("AVX-512")
+        {
+            if (juce::SystemStats::hasAVX512F())
+                checkKernel (&melatonin::blur::simd::avx512::integerARGB);
+        }
+    }
+}
+#endif
+
+TEST_CASE ("Melatonin Blur multithreading")
+{
+    // big enough for several strips and bands, with ragged edges
+    auto width = GENERATE (300, 517);
+    auto height = GENERATE (200, 333);
+    auto radius = GENERATE (1, 12, 254);
+
+    auto fillRandomly = [&] (juce::Image& img) {
+        juce::Random random (width * 1000 + height);
+        juce::Image::BitmapData data (img, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width; ++x)
+                for (auto c = 0; c < data.pixelStride; ++c)
+                    data.getPixelPointer (x, y)[c] = (uint8_t) random.nextInt (256);
+    };
+
+    juce::Image singleChannel (juce::Image::PixelFormat::SingleChannel, width, height, true);
+    juce::Image argb (juce::Image::PixelFormat::ARGB, width, height, true);
+    fillRandomly (singleChannel);
+    fillRandomly (argb);
+
+    auto blurBoth = [&] (juce::Image& singleChannelResult, juce::Image& argbResult) {
+        melatonin::blur::singleChannel (singleChannelResult, (size_t) radius);
+        auto argbSource = argb.createCopy();
+        melatonin::blur::argb (argbSource, argbResult, (size_t) radius);
+    };
+
+    auto expectedSingleChannel = singleChannel.createCopy();
+    auto expectedARGB = argb.createCopy();
+    blurBoth (expectedSingleChannel, expectedARGB);
+
+    melatonin::blur::enableMultithreading (3);
+    melatonin::blur::setMultithreadingThreshold (0);
+    REQUIRE (melatonin::blur::isMultithreadingEnabled());
+
+    auto actualSingleChannel = singleChannel.createCopy();
+    auto actualARGB = argb.createCopy();
+    blurBoth (actualSingleChannel, actualARGB);
+
+    melatonin::blur::disableMultithreading();
+    melatonin::blur::setMultithreadingThreshold (256 * 256);
+    REQUIRE_FALSE (melatonin::blur::isMultithreadingEnabled());
+
+    DYNAMIC_SECTION (width << "x" << height << " radius " << radius)
+    {
+        CHECK (imagesAreIdentical (expectedSingleChannel, actualSingleChannel));
+        CHECK (imagesAreIdentical (expectedARGB, actualARGB));
+    }
+}
+
+TEST_CASE ("Melatonin Blur scratch memory")
+{
+    using melatonin::blur::getScratchMemorySize;
+    melatonin::blur::releaseScratchMemory();
+    REQUIRE (getScratchMemorySize() == 0);
+
+    // the Gaussian kernel uses scratch memory on every platform
+    juce::Image image (juce::Image::PixelFormat::SingleChannel, 200, 100, true);
+    auto blur = [&] { melatonin::blur::singleChannel (image, 12, melatonin::blur::Kernel::gaussian); };
+
+    SECTION ("the next blur of the same size reuses it")
+    {
+        blur();
+        const auto size = getScratchMemorySize();
+        CHECK (size > 0);
+
+        blur();
+        CHECK (getScratchMemorySize() == size);
+    }
+
+    SECTION ("frames nest and hand out aligned memory")
+    {
+        melatonin::blur::ScratchFrame outer;
+        auto first = outer.allocate<uint8_t> (100);
+        {
+            // bigger than the block, so it grows while the outer frame still uses it
+            melatonin::blur::ScratchFrame inner;
+            auto second = inner.allocateZeroed<uint32_t> (1 << 20);
+            CHECK (second[1000] == 0);
+            CHECK (reinterpret_cast<uintptr_t> (second) % melatonin::blur::scratchAlignment == 0);
+        }
+
+        // the outer frame's memory is still there
+        first[99] = 42;
+        CHECK (first[99] == 42);
+        CHECK (reinterpret_cast<uintptr_t> (first) % melatonin::blur::scratchAlignment == 0);
+    }
+
+    SECTION ("trim keeps small blocks and drops big ones")
+    {
+        blur();
+        const auto size = getScratchMemorySize();
+
+        melatonin::blur::trimScratchMemory (size);
+        CHECK (getScratchMemorySize() == size);
+
+        melatonin::blur::trimScratchMemory (size - 1);
+        CHECK (getScratchMemorySize() == 0);
+    }
+}
+
+TEST_CASE ("Melatonin Blur large radius")
+{
+    auto format = GENERATE (juce::Image::PixelFormat::SingleChannel, juce::Image::PixelFormat::ARGB);
+    auto width = GENERATE (1, 7, 40);
+    auto height = GENERATE (1, 5, 30);
+    auto radius = GENERATE (255, 300, 1000, 5000);
+
+    juce::Image image (format, width, height, true);
+    {
+        juce::Random random (width * 1000 + height);
+        juce::Image::BitmapData data (image, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width * data.pixelStride; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+
+    // a stack blur is a triangle kernel: weights 1, 2 ... radius + 1 ... 2, 1, with the edge pixels repeated
+    auto expected = image.createCopy();
+    {
+        juce::Image::BitmapData data (expected, juce::Image::BitmapData::readWrite);
+        const auto channels = data.pixelStride;
+        const auto divisor = (int64_t) (radius + 1) * (radius + 1);
+        auto triangle = [&] (auto&& valueAt, int position, int size) {
+            int64_t sum = 0;
+            for (auto offset = -radius; offset <= radius; ++offset)
+                sum += (radius + 1 - std::abs (offset)) * (int64_t) valueAt (juce::jlimit (0, size - 1, position + offset));
+            return (uint8_t) (sum / divisor);
+        };
+
+        std::vector<uint8_t> horizontal ((size_t) (width * height * channels));
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width; ++x)
+                for (auto c = 0; c < channels; ++c)
+                    horizontal[(size_t) ((y * width + x) * channels + c)] = triangle ([&] (int i) { return data.getLinePointer (y)[i * channels + c]; }, x, width);
+
+        for (auto y = 0; y < height; ++y)
+            for (auto x = 0; x < width; ++x)
+                for (auto c = 0; c < channels; ++c)
+                    data.getLinePointer (y)[x * channels + c] = triangle ([&] (int i) { return horizontal[(size_t) ((i * width + x) * channels + c)]; }, y, height);
+    }
+
+    DYNAMIC_SECTION (width << "x" << height << " radius " << radius << (format == juce::Image::ARGB ? " ARGB" : " single channel"))
+    {
+        auto actual = image.createCopy();
+        if (format == juce::Image::SingleChannel)
+            melatonin::blur::singleChannel (actual, (size_t) radius);
+        else
+        {
+            auto source = image.createCopy();
+            melatonin::blur::argb (source, actual, (size_t) radius);
+        }
+
+        CHECK (imagesAreIdentical (expected, actual));
+    }
+}
+
+TEST_CASE ("Melatonin Blur Gaussian kernels")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::gaussian, Kernel::recursiveGaussian);
+
+    SECTION ("an impulse becomes a Gaussian with sigma = radius / 2")
+    {
+        auto radius = GENERATE (20, 41, 100);
+        const auto width = radius * 8 + 41;
+        const auto center = width / 2;
+
+        juce::Image image (juce::Image::PixelFormat::SingleChannel, width, 1, true);
+        image.setPixelAt (center, 0, juce::Colours::white);
+        melatonin::blur::singleChannel (image, (size_t) radius, kernel);
+
+        const auto sigma = radius / 2.0;
+        for (auto x = 0; x < width; ++x)
+        {
+            const auto distance = x - center;
+            const auto gaussian = 255.0 * std::exp (-distance * distance / (2 * sigma * sigma)) / (std::sqrt (2 * juce::MathConstants<double>::pi) * sigma);
+            CHECK (image.getPixelAt (x, 0).getAlpha() == Catch::Approx (gaussian).margin (1.0));
+        }
+    }
+
+    SECTION ("solid images stay solid")
+    {
+        auto format = GENERATE (juce::Image::PixelFormat::SingleChannel, juce::Image::PixelFormat::ARGB);
+        auto radius = GENERATE (1, 5, 37, 300);
+
+        juce::Image image (format, 40, 30, true);
+        image.clear (image.getBounds(), juce::Colours::red.withAlpha (0.5f));
+        auto expected = image.createCopy();
+
+        if (format == juce::Image::SingleChannel)
+            melatonin::blur::singleChannel (image, (size_t) radius, kernel);
+        else
+        {
+            auto source = image.createCopy();
+            melatonin::blur::argb (source, image, (size_t) radius, kernel);
+        }
+
+        CHECK (imagesAreIdentical (expected, image));
+    }
+}
+
+TEST_CASE ("Melatonin Blur recursive Gaussian edges")
+{
+    // blurring with the edges replicated far enough out that the filter has forgotten where they stop
+    auto radius = GENERATE (1, 4, 12, 40);
+    const auto width = 30;
+    const auto padding = radius * 10;
+
+    // not constant near either edge, so the backward pass can't start from the last forward output
+    auto fill = [&] (juce::Image& image, int offset) {
+        for (auto x = 0; x < image.getWidth(); ++x)
+        {
+            const auto source = juce::jlimit (0, width - 1, x - offset);
+            const auto value = source >= 24 ? 255 : (source * 37) % 200;
+            image.setPixelAt (x, 0, juce::Colours::white.withAlpha ((float) value / 255.0f));
+        }
+    };
+
+    juce::Image image (juce::Image::PixelFormat::SingleChannel, width, 1, true);
+    fill (image, 0);
+    juce::Image padded (juce::Image::PixelFormat::SingleChannel, width + 2 * padding, 1, true);
+    fill (padded, padding);
+
+    melatonin::blur::singleChannel (image, (size_t) radius, melatonin::blur::Kernel::recursiveGaussian);
+    melatonin::blur::singleChannel (padded, (size_t) radius, melatonin::blur::Kernel::recursiveGaussian);
+
+    for (auto x = 0; x < width; ++x)
+        CHECK (image.getPixelAt (x, 0).getAlpha() == Catch::Approx (padded.getPixelAt (x + padding, 0).getAlpha()).margin (1));
+}
+
+TEST_CASE ("Melatonin Blur dual filter")
+{
+    using melatonin::blur::Kernel;
+    auto format = GENERATE (juce::Image::PixelFormat::SingleChannel, juce::Image::PixelFormat::ARGB);
+
+    auto blur = [&] (juce::Image& image, int radius, Kernel kernel) {
+        if (format == juce::Image::SingleChannel)
+            melatonin::blur::singleChannel (image, (size_t) radius, kernel);
+        else
+        {
+            auto source = image.createCopy();
+            melatonin::blur::argb (source, image, (size_t) radius, kernel);
+        }
+    };
+
+    SECTION ("looks like the stack blur it stands in for")
+    {
+        auto radius = GENERATE (32, 64, 150);
+
+        juce::Image image (format, 400, 300, true);
+        image.clear ({ 100, 80, 200, 140 }, juce::Colours::white);
+        auto expected = image.createCopy();
+        blur (expected, radius, Kernel::stack);
+        blur (image, radius, Kernel::dualFilter);
+
+        for (auto y = 0; y < image.getHeight(); y += 7)
+            for (auto x = 0; x < image.getWidth(); x += 7)
+                CHECK (image.getPixelAt (x, y).getAlpha() == Catch::Approx (expected.getPixelAt (x, y).getAlpha()).margin (10));
+    }
+
+    SECTION ("solid images stay solid")
+    {
+        auto radius = GENERATE (1, 17, 64, 300);
+
+        juce::Image image (format, 41, 29, true);
+        image.clear (image.getBounds(), juce::Colours::red.withAlpha (0.5f));
+        auto expected = image.createCopy();
+        blur (image, radius, Kernel::dualFilter);
+
+        CHECK (imagesAreIdentical (expected, image));
+    }
+}
+
+TEST_CASE ("Melatonin Blur out of place ARGB")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian, Kernel::recursiveGaussian, Kernel::dualFilter);
+    auto radius = GENERATE (1, 3, 16, 40, 300);
+
+    juce::Image source (juce::Image::PixelFormat::ARGB, 67, 45, true);
+    {
+        juce::Random random (radius);
+        juce::Image::BitmapData data (source, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < data.height; ++y)
+            for (auto x = 0; x < data.width * 4; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+    auto untouched = source.createCopy();
+
+    // passing the same image twice blurs in place
+    auto expected = source.createCopy();
+    melatonin::blur::argb (expected, expected, (size_t) radius, kernel);
+
+    // dst starts out with garbage in it
+    juce::Image actual (juce::Image::PixelFormat::ARGB, 67, 45, false);
+    melatonin::blur::argb (source, actual, (size_t) radius, kernel);
+
+    CHECK (imagesAreIdentical (expected, actual));
+    CHECK (imagesAreIdentical (untouched, source));
+}
+
+TEST_CASE ("Melatonin Blur sparse ARGB")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian);
+    auto radius = GENERATE (1, 3, 16, 40, 300);
+
+    // a noisy sprite on a big transparent canvas
+    juce::Image source (juce::Image::PixelFormat::ARGB, 400, 300, true);
+    {
+        juce::Random random (radius);
+        juce::Image::BitmapData data (source, 180, 120, 23, 17, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < data.height; ++y)
+            for (auto x = 0; x < data.width * 4; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+
+    auto expected = source.createCopy();
+    melatonin::blur::denseARGB (expected, expected, (size_t) radius, kernel);
+
+    SECTION ("in place")
+    {
+        melatonin::blur::argb (source, source, (size_t) radius, kernel);
+        CHECK (imagesAreIdentical (expected, source));
+    }
+
+    SECTION ("out of place, clearing what's outside")
+    {
+        juce::Image actual (juce::Image::PixelFormat::ARGB, 400, 300, false);
+        actual.clear (actual.getBounds(), juce::Colours::red);
+        melatonin::blur::argb (source, actual, (size_t) radius, kernel);
+        CHECK (imagesAreIdentical (expected, actual));
+    }
+
+    SECTION ("nothing to blur")
+    {
+        juce::Image empty (juce::Image::PixelFormat::ARGB, 400, 300, true);
+        juce::Image actual (juce::Image::PixelFormat::ARGB, 400, 300, false);
+        actual.clear (actual.getBounds(), juce::Colours::red);
+        melatonin::blur::argb (empty, actual, (size_t) radius, kernel);
+        CHECK (imagesAreIdentical (empty, actual));
+    }
+
+    SECTION ("bounds")
+    {
+        CHECK (melatonin::blur::findNonZeroBounds (source) == juce::Rectangle<int> (180, 120, 23, 17));
+        source.setPixelAt (399, 0, juce::Colours::white.withAlpha (0.01f));
+        CHECK (melatonin::blur::findNonZeroBounds (source) == juce::Rectangle<int> (180, 0, 220, 137));
+    }
+}
+
+TEST_CASE ("Melatonin Blur opaque and grayscale ARGB")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian);
+    auto radius = GENERATE (1, 3, 16, 40, 300);
+    auto opaque = GENERATE (true, false);
+    auto grayscale = GENERATE (true, false);
+
+    juce::Image source (juce::Image::PixelFormat::ARGB, 67, 45, true);
+    {
+        juce::Random random (radius);
+        juce::Image::BitmapData data (source, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < data.height; ++y)
+        {
+            for (auto x = 0; x < data.width; ++x)
+            {
+                // premultiplied, so the colours can't be brighter than alpha
+                auto pixel = data.getPixelPointer (x, y);
+                const auto alpha = opaque ? 255 : random.nextInt (256);
+                const auto red = random.nextInt (alpha + 1);
+                pixel[juce::PixelARGB::indexA] = (uint8_t) alpha;
+                pixel[juce::PixelARGB::indexR] = (uint8_t) red;
+                pixel[juce::PixelARGB::indexG] = (uint8_t) (grayscale ? red : random.nextInt (alpha + 1));
+                pixel[juce::PixelARGB::indexB] = (uint8_t) (grayscale ? red : random.nextInt (alpha + 1));
+            }
+        }
+    }
+
+    auto content = melatonin::blur::findARGBContent (source);
+    CHECK (content.opaque == opaque);
+    CHECK (content.grayscale == grayscale);
+
+    // all 4 channels, the slow way
+    auto expected = source.createCopy();
+    melatonin::blur::denseARGB (expected, expected, (size_t) radius, kernel);
+
+    juce::Image actual (juce::Image::PixelFormat::ARGB, 67, 45, false);
+    melatonin::blur::argb (source, actual, (size_t) radius, kernel);
+    CHECK (imagesAreIdentical (expected, actual));
+}
+
+TEST_CASE ("Melatonin Blur image views")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian, Kernel::recursiveGaussian, Kernel::dualFilter);
+    auto radius = GENERATE (2, 16, 300);
+    auto pixelStride = GENERATE (1, 4);
+    const auto format = pixelStride == 1 ? juce::Image::PixelFormat::SingleChannel : juce::Image::PixelFormat::ARGB;
+
+    // premultiplied ARGB has to stay under its alpha, so it starts out as a blurred rectangle
+    juce::Image image (format, 45, 31, true);
+    image.clear ({ 8, 6, 20, 15 }, juce::Colours::white.withAlpha (0.6f));
+    image.clear ({ 30, 3, 9, 22 }, juce::Colours::red);
+
+    auto expected = image.createCopy();
+    auto blur = [&] (const melatonin::blur::ImageView& src, const melatonin::blur::ImageView& dst) {
+        if (pixelStride == 1)
+            melatonin::blur::singleChannel (src, dst, (size_t) radius, kernel);
+        else
+            melatonin::blur::argb (src, dst, (size_t) radius, kernel);
+    };
+
+    {
+        juce::Image::BitmapData data (expected, juce::Image::BitmapData::readWrite);
+        blur (melatonin::blur::viewOf (data), melatonin::blur::viewOf (data));
+    }
+
+    // a buffer the caller owns, with some padding at the end of each row
+    const size_t width = 45, height = 31, lineStride = width * (size_t) pixelStride + 13;
+    std::vector<uint8_t> source (lineStride * height), destination (lineStride * height, 0xff);
+    {
+        juce::Image::BitmapData data (image, juce::Image::BitmapData::readOnly);
+        for (size_t y = 0; y < height; ++y)
+            memcpy (source.data() + y * lineStride, data.getLinePointer ((int) y), width * (size_t) pixelStride);
+    }
+
+    const melatonin::blur::ImageView sourceView { source.data(), width, height, lineStride, (size_t) pixelStride };
+    const melatonin::blur::ImageView destinationView { destination.data(), width, height, lineStride, (size_t) pixelStride };
+
+    auto matchesExpected = [&] (const std::vector<uint8_t>& pixels) {
+        juce::Image::BitmapData data (expected, juce::Image::BitmapData::readOnly);
+        for (size_t y = 0; y < height; ++y)
+            if (memcmp (pixels.data() + y * lineStride, data.getLinePointer ((int) y), width * (size_t) pixelStride) != 0)
+                return false;
+        return true;
+    };
+
+    SECTION ("out of place")
+    {
+        auto untouched = source;
+        blur (sourceView, destinationView);
+        CHECK (matchesExpected (destination));
+        CHECK (source == untouched);
+    }
+
+    SECTION ("in place")
+    {
+        blur (sourceView, sourceView);
+        CHECK (matchesExpected (source));
+    }
+}
+
+TEST_CASE ("Melatonin Blur empty image views")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian, Kernel::recursiveGaussian, Kernel::dualFilter);
+    auto radius = GENERATE (2, 16, 300);
+    auto pixelStride = GENERATE (1, 4);
+    auto size = GENERATE (juce::Point<int> (0, 9), juce::Point<int> (9, 0));
+
+    // no rows or no columns, but real memory behind it, which has to stay untouched
+    const auto lineStride = 9 * (size_t) pixelStride;
+    std::vector<uint8_t> source (lineStride * 9, 0x5a), destination (lineStride * 9, 0xa5);
+    const auto untouchedSource = source;
+    const auto untouchedDestination = destination;
+
+    const melatonin::blur::ImageView sourceView { source.data(), (size_t) size.x, (size_t) size.y, lineStride, (size_t) pixelStride };
+    const melatonin::blur::ImageView destinationView { destination.data(), (size_t) size.x, (size_t) size.y, lineStride, (size_t) pixelStride };
+
+    auto blur = [&] (const melatonin::blur::ImageView& src, const melatonin::blur::ImageView& dst) {
+        if (pixelStride == 1)
+            melatonin::blur::singleChannel (src, dst, (size_t) radius, kernel);
+        else
+            melatonin::blur::argb (src, dst, (size_t) radius, kernel);
+    };
+
+    blur (sourceView, destinationView);
+    blur (sourceView, sourceView);
+    CHECK (source == untouchedSource);
+    CHECK (destination == untouchedDestination);
+}
@@ -0,0 +1,245 @@
+#include "../melatonin/cached_blur.h"
+#include "../melatonin/internal/implementations.h"
+#include "helpers/pixel_helpers.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE ("Melatonin Blur CachedBlur")
+{
+    juce::Image source (juce::Image::PixelFormat::ARGB, 50, 40, true);
+    source.clear ({ 10, 10, 20, 20 }, juce::Colours::white);
+    auto untouched = source.createCopy();
+
+    melatonin::CachedBlur blur (8);
+
+    SECTION ("blurs like argb, without touching the source")
+    {
+        auto expected = source.createCopy();
+        melatonin::blur::argb (expected, expected, 8);
+
+        CHECK (imagesAreIdentical (expected, blur.render (source)));
+        CHECK (imagesAreIdentical (untouched, source));
+    }
+
+    SECTION ("keeps its image while the size stays the same")
+    {
+        auto first = blur.render (source);
+
+        juce::Image moved (juce::Image::PixelFormat::ARGB, 50, 40, true);
+        moved.clear ({ 20, 15, 20, 20 }, juce::Colours::white);
+        auto expected = moved.createCopy();
+        melatonin::blur::argb (expected, expected, 8);
+
+        // same pixel data, new contents
+        auto& second = blur.render (moved);
+        CHECK (second == first);
+        CHECK (imagesAreIdentical (expected, second));
+
+        // a new size needs a new image
+        juce::Image bigger (juce::Image::PixelFormat::ARGB, 60, 40, true);
+        CHECK (blur.render (bigger) != first);
+        CHECK (blur.render().getWidth() == 60);
+    }
+
+    SECTION ("can blur its own output")
+    {
+        auto expected = source.createCopy();
+        melatonin::blur::argb (expected, expected, 8);
+        melatonin::blur::argb (expected, expected, 8);
+
+        auto once = blur.render (source);
+        CHECK (imagesAreIdentical (expected, blur.render (once)));
+    }
+}
+
+TEST_CASE ("Melatonin Blur CachedBlur content changes")
+{
+    juce::Image source (juce::Image::PixelFormat::ARGB, 50, 40, true);
+    source.clear ({ 10, 10, 20, 20 }, juce::Colours::white);
+
+    melatonin::CachedBlur blur (8);
+    blur.render (source);
+
+    // drawing into the same image, like juce::ImageEffectFilter::applyEffect would
+    auto drawInto = [&] (juce::Rectangle<int> area) {
+        source.clear (area, juce::Colours::red);
+        auto expected = source.createCopy();
+        melatonin::blur::argb (expected, expected, 8);
+        return expected;
+    };
+
+    // a blur that's been reused shows this marker instead of a fresh result
+    auto mark = [&] { blur.render().setPixelAt (0, 0, juce::Colours::black); };
+    auto reblurred = [&] { return blur.render().getPixelAt (0, 0).getAlpha() == 0; };
+
+    SECTION ("the same image is cached by default")
+    {
+        drawInto ({ 30, 20, 5, 5 });
+        mark();
+        blur.render (source);
+        CHECK_FALSE (reblurred());
+    }
+
+    SECTION ("markDirty reblurs")
+    {
+        auto expected = drawInto ({ 30, 20, 5, 5 });
+        blur.markDirty();
+        CHECK (imagesAreIdentical (expected, blur.render (source)));
+    }
+
+    SECTION ("a new revision reblurs, the same one doesn't")
+    {
+        auto expected = drawInto ({ 30, 20, 5, 5 });
+        CHECK (imagesAreIdentical (expected, blur.render (source, 1)));
+
+        mark();
+        blur.render (source, 1);
+        CHECK_FALSE (reblurred());
+    }
+
+    SECTION ("content detection reblurs exactly when the pixels change")
+    {
+        blur.setDetectContentChanges (true);
+        blur.render (source);
+
+        mark();
+        blur.render (source);
+        CHECK_FALSE (reblurred());
+
+        // a single pixel is enough
+        auto expected = drawInto ({ 49, 39, 1, 1 });
+        CHECK (imagesAreIdentical (expected, blur.render (source)));
+
+        mark();
+        blur.render (source);
+        CHECK_FALSE (reblurred());
+    }
+}
+
+TEST_CASE ("Melatonin Blur CachedBlur dirty areas")
+{
+    auto radius = GENERATE (1, 8, 40);
+
+    // lots of detail, so a wrong pixel anywhere shows up
+    juce::Image source (juce::Image::PixelFormat::ARGB, 120, 90, true);
+    {
+        juce::Random random (radius);
+        juce::Image::BitmapData data (source, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < data.height; ++y)
+            for (auto x = 0; x < data.width * 4; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+
+    melatonin::CachedBlur blur ((size_t) radius);
+    blur.render (source);
+
+    auto fullBlur = [&] {
+        auto expected = source.createCopy();
+        melatonin::blur::argb (expected, expected, (size_t) radius);
+        return expected;
+    };
+
+    SECTION ("matches a full update, in the middle and at the edges")
+    {
+        for (auto area : { juce::Rectangle<int> { 50, 40, 6, 3 }, { 0, 0, 4, 4 }, { 110, 85, 10, 5 }, { 0, 30, 120, 1 } })
+        {
+            source.clear (area, juce::Colours::red);
+            blur.update (source, area);
+
+            auto expected = fullBlur();
+            CHECK (imagesAreIdentical (expected, blur.render()));
+        }
+    }
+
+    SECTION ("found automatically, only that area is reblurred")
+    {
+        blur.setDetectChangedAreas (true);
+        blur.render (source);
+
+        // far enough from the change that it must be left alone
+        blur.render().setPixelAt (0, 0, juce::Colours::black);
+
+        source.setPixelAt (100, 70, juce::Colours::white);
+        source.setPixelAt (105, 72, juce::Colours::white);
+        auto expected = fullBlur();
+        expected.setPixelAt (0, 0, juce::Colours::black);
+
+        CHECK (imagesAreIdentical (expected, blur.render (source)));
+    }
+}
+
+TEST_CASE ("Melatonin Blur changed areas")
+{
+    juce::Image before (juce::Image::PixelFormat::ARGB, 30, 20, true);
+    auto after = before.createCopy();
+    CHECK (melatonin::blur::findChangedArea (before, after).isEmpty());
+
+    after.setPixelAt (4, 3, juce::Colours::red);
+    CHECK (melatonin::blur::findChangedArea (before, after) == juce::Rectangle<int> (4, 3, 1, 1));
+
+    after.setPixelAt (29, 10, juce::Colours::red);
+    after.setPixelAt (0, 19, juce::Colours::red);
+    CHECK (melatonin::blur::findChangedArea (before, after) == juce::Rectangle<int> (0, 3, 30, 17));
+}
+
+TEST_CASE ("Melatonin Blur regions")
+{
+    using melatonin::blur::Kernel;
+    auto kernel = GENERATE (Kernel::stack, Kernel::gaussian);
+    auto radius = GENERATE (1, 8, 40);
+
+    juce::Image source (juce::Image::PixelFormat::ARGB, 120, 90, true);
+    {
+        juce::Random random (radius);
+        juce::Image::BitmapData data (source, juce::Image::BitmapData::readWrite);
+        for (auto y = 0; y < data.height; ++y)
+            for (auto x = 0; x < data.width * 4; ++x)
+                data.getLinePointer (y)[x] = (uint8_t) random.nextInt (256);
+    }
+    auto untouched = source.createCopy();
+
+    // the same pixels as blurring everything and cropping
+    auto fullBlur = source.createCopy();
+    melatonin::blur::argb (fullBlur, fullBlur, (size_t) radius, kernel);
+    auto expectedFor = [&] (juce::Rectangle<int> region) {
+        juce::Image expected (juce::Image::PixelFormat::ARGB, region.getWidth(), region.getHeight(), false);
+        melatonin::blur::copyPixels (fullBlur, region, expected, {});
+        return expected;
+    };
+
+    SECTION ("in the middle and at the edges")
+    {
+        for (auto region : { juce::Rectangle<int> { 30, 20, 40, 30 }, { 0, 0, 25, 90 }, { 100, 70, 20, 20 }, { 0, 0, 120, 90 } })
+        {
+            juce::Image actual (juce::Image::PixelFormat::ARGB, region.getWidth(), region.getHeight(), false);
+            melatonin::blur::argb (source, region, actual, (size_t) radius, kernel);
+
+            auto expected = expectedFor (region);
+            CHECK (imagesAreIdentical (expected, actual));
+        }
+
+        CHECK (imagesAreIdentical (untouched, source));
+    }
+
+    SECTION ("cached")
+    {
+        melatonin::CachedBlur blur ((size_t) radius);
+        blur.setKernel (kernel);
+
+        const juce::Rectangle<int> region { 30, 20, 40, 30 };
+        auto expected = expectedFor (region);
+        CHECK (imagesAreIdentical (expected, blur.renderRegion (source, region)));
+
+        // the same region of the same image is cached
+        blur.render().setPixelAt (0, 0, juce::Colours::black);
+        blur.renderRegion (source, region);
+        CHECK (blur.render().getPixelAt (0, 0).getAlpha() == 255);
+
+        // a different one isn't
+        const juce::Rectangle<int> moved { 31, 20, 40, 30 };
+        expected = expectedFor (moved);
+        CHECK (imagesAreIdentical (expected, blur.renderRegion (source, moved)));
+
+        // and the whole image is back to a full blur
+        CHECK (imagesAreIdentical (fullBlur, blur.render (source)));
+    }
+}
@@ -224,6 +224,21 @@ inline void setActualPixel (uint8_t* jucePixel, ActualPixel actualPixel)
     return true;
 }
 
+// The most any byte of two images differs by, 0 when they're identical (256 when they aren't the same size or format)
+[[maybe_unused]] static int maxPixelDifference (const juce::Image& img1, const juce::Image& img2)
+{
+    if (img1.getBounds() != img2.getBounds() || img1.getFormat() != img2.getFormat())
+        return 256;
+
+    juce::Image::BitmapData data1 (img1, juce::Image::BitmapData::readOnly);
+    juce::Image::BitmapData data2 (img2, juce::Image::BitmapData::readOnly);
+    int maxDifference = 0;
+    for (auto y = 0; y < data1.height; ++y)
+        for (auto x = 0; x < data1.width * data1.pixelStride; ++x)
+            maxDifference = std::max (maxDifference, std::abs (data1.getLinePointer (y)[x] - data2.getLinePointer (y)[x]));
+    return maxDifference;
+}
+
 [[maybe_unused]] static void print_test_image (juce::Image& image)
 {
     // this is meant for testing trivial examples
@@ -1,3 +1,5 @@
+#include "../melatonin/internal/rounded_rectangle_shadow.h"
+#include "../melatonin/internal/symmetric_shadow.h"
 #include "../melatonin/shadows.h"
 #include "helpers/pixel_helpers.h"
 #include <catch2/catch_approx.hpp>
@@ -158,3 +160,190 @@ TEST_CASE ("Melatonin Blur Render To Single Channel")
         }
     }
 }
+
+TEST_CASE ("Melatonin Blur Rounded Rectangle Shadows")
+{
+    using namespace melatonin::internal;
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    // the middles of the bigger ones are stretched, (2, 3) is too small to be
+    auto radius = GENERATE (1, 4, 12, 40, 300);
+    auto area = GENERATE (juce::Rectangle<float> (60.0f, 32.5f), juce::Rectangle<float> (0.25f, 0.5f, 147.75f, 90.0f), juce::Rectangle<float> (2.0f, 3.0f), juce::Rectangle<float> (40.0f, 7.0f), juce::Rectangle<float> (200.0f, 150.0f));
+    auto cornerSize = GENERATE (0.0f, 2.5f, 5.0f, 14.0f);
+    auto spread = GENERATE (0, 3);
+    auto inner = GENERATE (false, true);
+    auto scale = GENERATE (1.0f, 1.5f, 2.0f);
+
+    juce::Path rectangle;
+    rectangle.addRoundedRectangle (area, cornerSize);
+    REQUIRE (melatonin::blur::findRoundedRectangle (rectangle).has_value());
+
+    // the same shape plus an empty subpath isn't detected, so it's filled and blurred
+    auto filled = rectangle;
+    filled.startNewSubPath (1, 1);
+    filled.closeSubPath();
+    REQUIRE_FALSE (melatonin::blur::findRoundedRectangle (filled).has_value());
+
+    const melatonin::ShadowParametersInt parameters { juce::Colours::black, radius, {}, spread, inner };
+    auto expected = RenderedSingleChannelShadow (parameters).render (filled, scale);
+    auto actual = RenderedSingleChannelShadow (parameters).render (rectangle, scale);
+    REQUIRE (actual.getBounds() == expected.getBounds());
+
+    // rectangles on whole pixels get the blur's pixels exactly,
+    // the rest are calculated without filling or blurring, which round differently
+    const auto scaled = area.expanded ((float) (inner ? -spread : spread)) * scale;
+    auto isWhole = [] (float value) { return juce::approximatelyEqual (value, std::round (value)); };
+    const auto onWholePixels = cornerSize <= 0 && isWhole (scaled.getX()) && isWhole (scaled.getY()) && isWhole (scaled.getRight()) && isWhole (scaled.getBottom());
+    CHECK (maxPixelDifference (actual, expected) <= (onWholePixels ? 0 : melatonin::blur::maxRoundedRectangleError));
+}
+
+TEST_CASE ("Melatonin Blur Nine Patch Shadows")
+{
+    using namespace melatonin::internal;
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    auto cornerSize = GENERATE (0.0f, 8.0f);
+    auto spread = GENERATE (0, 2);
+    auto inner = GENERATE (false, true);
+    const melatonin::ShadowParametersInt parameters { juce::Colours::black, 6, {}, spread, inner };
+
+    // resized around like a panel would be, each time reusing (or not) what the last size left behind
+    RenderedSingleChannelShadow resized (parameters);
+    for (auto size : { juce::Point<float> (100, 40), juce::Point<float> (180, 40), juce::Point<float> (180, 90.5f), juce::Point<float> (20, 12), juce::Point<float> (180, 90.5f) })
+    {
+        juce::Path path;
+        path.addRoundedRectangle (juce::Rectangle<float> (size.x, size.y), cornerSize);
+
+        auto actual = resized.render (path, 1.0f);
+        auto expected = RenderedSingleChannelShadow (parameters).render (path, 1.0f);
+        REQUIRE (actual.getBounds() == expected.getBounds());
+        CHECK (maxPixelDifference (actual, expected) == 0);
+    }
+}
+
+TEST_CASE ("Melatonin Blur Finds Rounded Rectangles")
+{
+    juce::Path path;
+    CHECK_FALSE (melatonin::blur::findRoundedRectangle (path).has_value());
+
+    path.addRectangle (10.5f, 3, 40, 20);
+    auto found = melatonin::blur::findRoundedRectangle (path);
+    REQUIRE (found.has_value());
+    CHECK (found->area == juce::Rectangle<float> (10.5f, 3, 40, 20));
+    CHECK (found->cornerSize.x == Catch::Approx (0));
+
+    path.clear();
+    path.addRoundedRectangle (juce::Rectangle<float> (10.5f, 3, 40, 20), 6);
+    found = melatonin::blur::findRoundedRectangle (path);
+    REQUIRE (found.has_value());
+    CHECK (found->area == juce::Rectangle<float> (10.5f, 3, 40, 20));
+    CHECK (found->cornerSize.x == Catch::Approx (6));
+
+    // moved around like CachedShadows does
+    path.applyTransform (juce::AffineTransform::translation (-10.5f, -3));
+    CHECK (melatonin::blur::findRoundedRectangle (path).has_value());
+
+    path.clear();
+    path.addEllipse (0, 0, 40, 20);
+    CHECK_FALSE (melatonin::blur::findRoundedRectangle (path).has_value());
+
+    path.clear();
+    path.addRectangle (0, 0, 10, 10);
+    path.addRectangle (20, 0, 10, 10);
+    CHECK_FALSE (melatonin::blur::findRoundedRectangle (path).has_value());
+}
+
+TEST_CASE ("Melatonin Blur Symmetric Shadows")
+{
+    using namespace melatonin::internal;
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    // odd sizes and fractional positions don't always fill symmetrically, those are blurred in full
+    auto radius = GENERATE (1, 2, 9, 40);
+    auto area = GENERATE (juce::Rectangle<float> (30, 30), juce::Rectangle<float> (64, 21), juce::Rectangle<float> (7, 120),
+        juce::Rectangle<float> (33.5f, 17.25f), juce::Rectangle<float> (0.5f, 0.25f, 41, 40));
+    auto spread = GENERATE (0, 2);
+    auto inner = GENERATE (false, true);
+    auto scale = GENERATE (1.0f, 1.5f, 2.0f);
+
+    juce::Path ellipse;
+    ellipse.addEllipse (area);
+    REQUIRE (melatonin::blur::isEllipse (ellipse));
+
+    // the same shape plus an empty subpath isn't detected, so it's filled and blurred in full
+    auto filled = ellipse;
+    filled.startNewSubPath (1, 1);
+    filled.closeSubPath();
+    REQUIRE_FALSE (melatonin::blur::isEllipse (filled));
+
+    const melatonin::ShadowParametersInt parameters { juce::Colours::black, radius, {}, spread, inner };
+    auto expected = RenderedSingleChannelShadow (parameters).render (filled, scale);
+    auto actual = RenderedSingleChannelShadow (parameters).render (ellipse, scale);
+    REQUIRE (actual.getBounds() == expected.getBounds());
+
+    // only filled paths that are mirrored to the pixel are mirrored, so there's no tolerance
+    CHECK (maxPixelDifference (actual, expected) == 0);
+}
+
+TEST_CASE ("Melatonin Blur Finds Ellipses")
+{
+    juce::Path path;
+    CHECK_FALSE (melatonin::blur::isEllipse (path));
+
+    path.addEllipse (3.5f, 2, 40, 40);
+    CHECK (melatonin::blur::isEllipse (path));
+
+    path.clear();
+    path.addEllipse (0, 0, 80, 12.5f);
+    CHECK (melatonin::blur::isEllipse (path));
+
+    path.clear();
+    path.addRoundedRectangle (juce::Rectangle<float> (40, 40), 20);
+    CHECK_FALSE (melatonin::blur::isEllipse (path));
+
+    path.clear();
+    path.addEllipse (0, 0, 10, 10);
+    path.addEllipse (20, 0, 10, 10);
+    CHECK_FALSE (melatonin::blur::isEllipse (path));
+}
+
+TEST_CASE ("Melatonin Blur Shared Shadow Masks")
+{
+    using namespace melatonin::internal;
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    // not a shape with a shortcut, so it's filled and blurred
+    // (off whole pixels, what inner shadows fill around it depends on the radius)
+    auto width = GENERATE (40.0f, 40.5f);
+    juce::Path triangle;
+    triangle.addTriangle (0, 0, width, 10, 12, 30);
+
+    auto spread = GENERATE (0, 3);
+    auto inner = GENERATE (false, true);
+    auto scale = GENERATE (1.0f, 2.0f);
+
+    SECTION ("cropping a shared mask gives the same blur as filling the path")
+    {
+        RenderedSingleChannelShadow::SharedMask mask;
+        RenderedSingleChannelShadow large ({ juce::Colours::black, 12, {}, spread, inner });
+        RenderedSingleChannelShadow small ({ juce::Colours::black, 3, {}, spread, inner });
+        large.render (triangle, scale, false, &mask);
+        small.render (triangle, scale, false, &mask);
+        CHECK_FALSE (mask.image.isNull());
+
+        CHECK (maxPixelDifference (large.getImage(), RenderedSingleChannelShadow ({ juce::Colours::black, 12, {}, spread, inner }).render (triangle, scale)) == 0);
+        CHECK (maxPixelDifference (small.getImage(), RenderedSingleChannelShadow ({ juce::Colours::black, 3, {}, spread, inner }).render (triangle, scale)) == 0);
+    }
+
+    SECTION ("shadows with the same blur share its image")
+    {
+        RenderedSingleChannelShadow first ({ juce::Colours::red, 5, { 2, 3 }, spread, inner });
+        RenderedSingleChannelShadow second ({ juce::Colours::blue, 5, { -4, 1 }, spread, inner });
+        first.render (triangle, scale);
+        second.renderLike (first, scale);
+
+        CHECK (second.getImage() == first.getImage());
+        CHECK (second.getScaledPathBounds() == first.getScaledPathBounds());
+        CHECK (second.getScaledBounds() == first.getScaledBounds() + ((juce::Point<int> (-4, 1) - juce::Point<int> (2, 3)) * scale).roundToInt());
+    }
+}